@@ -0,0 +1,173 @@
+#ifndef BATCH_RENDERER_H
+#define BATCH_RENDERER_H
+
+#include "RenderTarget.hpp"
+#include "ImageWriter.hpp"
+#include "Readback.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Batch thumbnail renderer: renders every job of a job list into one offscreen
+// target, reusing the same context, program and model for all of them.
+// Readback goes through the PBO ring and encoding runs on worker threads,
+// so the GPU keeps rendering the next jobs meanwhile.
+//
+// Job file format, one directive per line ('#' starts a comment):
+//   materials <white> <black> <base> <whiteSquares> <blackSquares>   ('*' = every choice)
+//   camera <yaw> <pitch> <radius>
+// Every material combination is rendered from every camera.
+class BatchRenderer
+{
+public:
+    enum Slot { White, Black, Base, WhiteSquares, BlackSquares, SlotCount };
+
+    struct Job
+    {
+        int material[SlotCount];
+        float yaw, pitch, radius;
+        std::string name;
+    };
+
+    std::vector<Job> jobs;
+    std::string outputDir = "thumbnails";
+    int atlasColumns = 0;               // > 0: pack everything into one atlas.png
+
+    // maxChoices: number of materials available for each slot
+    bool Load(const std::string& path, const int maxChoices[SlotCount])
+    {
+        std::ifstream in(path);
+        if (!in) {
+            std::cerr << "Batch: cannot read " << path << std::endl;
+            return false;
+        }
+        std::vector<std::vector<int>> combos;
+        struct Camera { float yaw, pitch, radius; };
+        std::vector<Camera> cameras;
+
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(in, line)) {
+            lineNumber++;
+            line = line.substr(0, line.find('#'));
+            std::istringstream ss(line);
+            std::string directive;
+            if (!(ss >> directive)) continue;
+
+            if (directive == "materials") {
+                std::vector<std::vector<int>> expanded(1);
+                for (int slot = 0; slot < SlotCount; slot++) {
+                    std::string token;
+                    if (!(ss >> token)) return parseError(path, lineNumber);
+                    std::vector<int> choices;
+                    if (token == "*") {
+                        for (int c = 1; c <= maxChoices[slot]; c++) choices.push_back(c);
+                    }
+                    else {
+                        char* end = nullptr;
+                        long c = std::strtol(token.c_str(), &end, 10);
+                        if (*end != '\0' || c < 1 || c > maxChoices[slot]) return parseError(path, lineNumber);
+                        choices.push_back((int)c);
+                    }
+                    std::vector<std::vector<int>> next;
+                    for (auto& partial : expanded)
+                        for (int c : choices) {
+                            next.push_back(partial);
+                            next.back().push_back(c);
+                        }
+                    expanded.swap(next);
+                }
+                combos.insert(combos.end(), expanded.begin(), expanded.end());
+            }
+            else if (directive == "camera") {
+                Camera c;
+                if (!(ss >> c.yaw >> c.pitch >> c.radius)) return parseError(path, lineNumber);
+                cameras.push_back(c);
+            }
+            else {
+                return parseError(path, lineNumber);
+            }
+            std::string extra;
+            if (ss >> extra) return parseError(path, lineNumber);
+        }
+        if (combos.empty()) {
+            std::cerr << "Batch: " << path << ": no materials lines, nothing to render" << std::endl;
+            return false;
+        }
+        if (cameras.empty()) cameras.push_back({ 0.0f, 20.0f, 8.0f });
+
+        for (auto& combo : combos) {
+            for (size_t c = 0; c < cameras.size(); c++) {
+                Job job;
+                std::ostringstream name;
+                name << "w" << combo[White] << "_b" << combo[Black] << "_base" << combo[Base]
+                    << "_ws" << combo[WhiteSquares] << "_bs" << combo[BlackSquares] << "_cam" << c;
+                for (int slot = 0; slot < SlotCount; slot++) job.material[slot] = combo[slot];
+                job.yaw = cameras[c].yaw;
+                job.pitch = cameras[c].pitch;
+                job.radius = cameras[c].radius;
+                job.name = name.str();
+                jobs.push_back(job);
+            }
+        }
+        std::cout << "Batch: " << jobs.size() << " jobs (" << combos.size() << " material sets x "
+            << cameras.size() << " cameras)" << std::endl;
+        return true;
+    }
+
+    // renderJob draws a job into the currently bound target
+    bool Run(RenderTarget& target, AsyncReadback& readback, const std::function<void(const Job&)>& renderJob)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(outputDir, ec);
+
+        const int w = target.width, h = target.height;
+        const size_t rowBytes = (size_t)w * 3;
+        int atlasRows = atlasColumns > 0 ? ((int)jobs.size() + atlasColumns - 1) / atlasColumns : 0;
+        std::vector<unsigned char> atlas;
+        if (atlasColumns > 0) atlas.assign(rowBytes * atlasColumns * h * atlasRows, 0);
+
+        std::atomic<bool> ok{ true };
+        double total = readback.CaptureSequence(target, (int)jobs.size(), [&](int i) { renderJob(jobs[i]); },
+            [&](int i, std::vector<unsigned char>& pixels, int, int) {
+                if (atlasColumns > 0) {
+                    // bottom-up rows from GL, top-down in the atlas; every job owns its own cell
+                    size_t atlasRowBytes = rowBytes * atlasColumns;
+                    size_t col = i % atlasColumns, row = i / atlasColumns;
+                    for (int y = 0; y < h; y++) {
+                        unsigned char* dst = &atlas[(row * h + y) * atlasRowBytes + col * rowBytes];
+                        std::copy_n(&pixels[(size_t)(h - 1 - y) * rowBytes], rowBytes, dst);
+                    }
+                }
+                else if (!writePng(outputDir + "/" + jobs[i].name + ".png", w, h, 3, pixels.data(), true)) {
+                    ok = false;
+                }
+            });
+
+        if (atlasColumns > 0 && !jobs.empty() &&
+            !writePng(outputDir + "/atlas.png", w * atlasColumns, h * atlasRows, 3, atlas.data(), false))
+            ok = false;
+
+        std::cout << "Batch: " << jobs.size() << " images in " << total << " s, "
+            << (total > 0.0 ? jobs.size() / total : 0.0) << " images/s (readback latency "
+            << readback.AverageLatencyFrames() << " jobs, " << readback.Stalls() << " stalls)" << std::endl;
+        return ok;
+    }
+
+private:
+    static bool parseError(const std::string& path, int line)
+    {
+        std::cerr << "Batch: " << path << ":" << line << ": invalid job line" << std::endl;
+        return false;
+    }
+};
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// Deterministic benchmark: a scripted orbit-and-zoom camera path and a fixed
+// material schedule replace user input for a fixed number of frames.
+// Frame times and the GPU time of every profiler scope end up in a JSON report.
+class Benchmark
+{
+public:
+    bool enabled = false;
+    int frames = 600;               // measured frames
+    int warmupFrames = 30;          // rendered first, not measured
+    int materialPeriod = 60;        // frames between two material changes
+    std::string outputPath = "benchmark.json";
+
+    struct CameraPose
+    {
+        float yaw, pitch, radius;
+    };
+
+    int TotalFrames() const { return warmupFrames + frames; }
+    int Frame() const { return frame; }
+    bool Finished() const { return frame >= TotalFrames(); }
+    bool Measuring() const { return frame >= warmupFrames; }
+
+    // Camera for a frame: two full orbits while pitching up and down and zooming in and out
+    CameraPose CameraAt(int i) const
+    {
+        const float pi = 3.14159265f;
+        float t = (float)i / (float)TotalFrames();
+        CameraPose pose;
+        pose.yaw = 720.0f * t;
+        pose.pitch = 35.0f + 30.0f * std::sin(2.0f * pi * t);
+        pose.radius = 2.0f + 14.0f * (0.5f + 0.5f * std::cos(4.0f * pi * t));
+        return pose;
+    }
+
+    // Index of the material combination shown at a frame
+    int MaterialStepAt(int i) const { return i / materialPeriod; }
+
+    void Start()
+    {
+        frame = 0;
+        frameTimes.clear();
+        gpuTimes.clear();
+        lastSwap = Clock::now();
+    }
+
+    // Call after every swap
+    void FrameDone()
+    {
+        Clock::time_point now = Clock::now();
+        if (Measuring())
+            frameTimes.push_back(std::chrono::duration<float, std::milli>(now - lastSwap).count());
+        lastSwap = now;
+        frame++;
+    }
+
+    // GPU time of a profiler scope (results arrive a few frames late; warmup absorbs that)
+    void AddGpuTime(const char* scope, float ms)
+    {
+        if (Measuring()) gpuTimes[scope].push_back(ms);
+    }
+
+    bool Write(const std::string& renderer, const std::string& version, int width, int height) const
+    {
+        std::ofstream out(outputPath);
+        if (!out) {
+            std::cerr << "Benchmark: cannot write " << outputPath << std::endl;
+            return false;
+        }
+        out << "{\n";
+        out << "  \"renderer\": \"" << escape(renderer) << "\",\n";
+        out << "  \"version\": \"" << escape(version) << "\",\n";
+        out << "  \"resolution\": [" << width << ", " << height << "],\n";
+        out << "  \"frames\": " << frames << ",\n";
+        out << "  \"warmupFrames\": " << warmupFrames << ",\n";
+        out << "  \"frameTimeMs\": " << stats(frameTimes) << ",\n";
+        out << "  \"gpuMs\": {";
+        bool first = true;
+        for (auto& g : gpuTimes) {
+            out << (first ? "\n" : ",\n") << "    \"" << escape(g.first) << "\": " << stats(g.second);
+            first = false;
+        }
+        out << "\n  }\n}\n";
+
+        std::cout << "Benchmark: " << frameTimes.size() << " frames, " << stats(frameTimes)
+            << " -> " << outputPath << std::endl;
+        return true;
+    }
+
+private:
+    using Clock = std::chrono::high_resolution_clock;
+
+    int frame = 0;
+    Clock::time_point lastSwap;
+    std::vector<float> frameTimes;
+    std::map<std::string, std::vector<float>> gpuTimes;
+
+    // JSON string contents: driver strings may hold quotes, backslashes or control characters
+    static std::string escape(const std::string& s)
+    {
+        std::string r;
+        for (char c : s) {
+            if (c == '"' || c == '\\') {
+                r += '\\';
+                r += c;
+            }
+            else if ((unsigned char)c < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)c);
+                r += buf;
+            }
+            else
+                r += c;
+        }
+        return r;
+    }
+
+    static std::string stats(std::vector<float> v)
+    {
+        if (v.empty()) return "null";
+        std::sort(v.begin(), v.end());
+        double sum = 0.0;
+        for (float f : v) sum += f;
+        auto pct = [&](float p) { return v[std::min(v.size() - 1, (size_t)(p * (v.size() - 1) + 0.5f))]; };
+        char buf[256];
+        snprintf(buf, sizeof(buf),
+            "{\"avg\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"min\": %.4f, \"max\": %.4f}",
+            sum / v.size(), pct(0.50f), pct(0.95f), pct(0.99f), v.front(), v.back());
+        return buf;
+    }
+};
+
+#endif
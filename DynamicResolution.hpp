@@ -0,0 +1,106 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "RenderTarget.hpp"
+
+// Dynamic resolution: the 3D scene is rendered into an offscreen target at a
+// fraction of the window size and upscaled with a linear blit before the UI is
+// drawn on top. The scale follows the GPU time of the scene pass, measured with
+// GL_TIME_ELAPSED queries read back a few frames later, toward a target budget.
+class DynamicResolution
+{
+public:
+    static const int queryFrames = 3;
+
+    bool enabled = false;
+    float targetMs = 13.3f;     // scene budget: 80% of a 60 fps frame
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    float scale = 1.0f;
+
+    void Init()
+    {
+        glGenQueries(queryFrames, queries);
+    }
+
+    void Destroy()
+    {
+        if (queries[0]) glDeleteQueries(queryFrames, queries);
+        queries[0] = 0;
+        target.Destroy();
+    }
+
+    // Target budget from a frame rate (> 0), leaving room for the UI, blit and swap
+    void SetTargetFps(float fps) { targetMs = 0.8f * 1000.0f / fps; }
+
+    // Bind the scaled scene target (re-created when the window size changed)
+    void BeginScene(int windowWidth, int windowHeight)
+    {
+        collect();
+        if (target.width != windowWidth || target.height != windowHeight || !target.fbo)
+            target.Create(windowWidth, windowHeight);
+
+        width = std::max(1, (int)std::lround(windowWidth * scale));
+        height = std::max(1, (int)std::lround(windowHeight * scale));
+        target.Bind();
+        glViewport(0, 0, width, height);
+
+        int q = frame % queryFrames;
+        glBeginQuery(GL_TIME_ELAPSED, queries[q]);
+        pending[q] = true;
+    }
+
+    // Upscale the scene into the window's framebuffer
+    void EndScene(int windowWidth, int windowHeight)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        frame++;
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, target.fbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, windowWidth, windowHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, windowWidth, windowHeight);
+    }
+
+    int Width() const { return width; }
+    int Height() const { return height; }
+    float SceneGpuMs() const { return sceneMs; }
+
+private:
+    RenderTarget target;
+    GLuint queries[queryFrames] = {};
+    bool pending[queryFrames] = {};
+    int frame = 0;
+    int width = 0, height = 0;
+    float sceneMs = 0.0f;
+
+    // read the oldest query, if ready, and steer the scale
+    void collect()
+    {
+        int q = frame % queryFrames;
+        if (!pending[q]) return;
+        GLint available = 0;
+        glGetQueryObjectiv(queries[q], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return;     // reused below: the result is simply dropped
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(queries[q], GL_QUERY_RESULT, &ns);
+        pending[q] = false;
+        sceneMs = (float)(ns / 1e6);
+        if (!enabled || sceneMs <= 0.0f) return;
+
+        // GPU time goes with the pixel count, i.e. with scale^2
+        float ratio = targetMs / sceneMs;
+        if (ratio > 0.95f && ratio < 1.05f) return;     // dead band against oscillation
+        float wanted = scale * std::sqrt(ratio);
+        scale += (wanted - scale) * 0.2f;
+        scale = std::min(maxScale, std::max(minScale, scale));
+    }
+};
+
+#endif
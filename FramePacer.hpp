@@ -0,0 +1,143 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+// Frame pacing on top of the GLFW loop: vsync through glfwSwapInterval,
+// a sleep-plus-spin frame cap and throttling while the window is in the background.
+class FramePacer
+{
+public:
+    bool  vsync = true;
+    float fpsCap = 0.0f;                // 0 = uncapped
+    bool  throttleInBackground = true;
+    float backgroundFps = 10.0f;        // cap used while the window is unfocused
+
+    static const int historySize = 240;
+
+    void Init(GLFWwindow* window)
+    {
+        this->window = window;
+        frameTimes.assign(historySize, 0.0f);
+        SetVSync(vsync);
+        Resync();
+    }
+
+    void SetVSync(bool enabled)
+    {
+        vsync = enabled;
+        glfwSwapInterval(vsync ? 1 : 0);
+    }
+
+    // True when the window is minimized: the caller should block in glfwWaitEvents
+    bool IsIconified() const
+    {
+        return throttleInBackground && glfwGetWindowAttrib(window, GLFW_ICONIFIED);
+    }
+
+    // Forget the previous frame, e.g. after sleeping in glfwWaitEvents
+    void Resync()
+    {
+        lastFrameEnd = Clock::now();
+    }
+
+    // Call right after glfwSwapBuffers: waits out the active cap and records the frame time
+    void EndFrame()
+    {
+        float cap = ActiveCap();
+        if (cap > 0.0f) {
+            auto target = lastFrameEnd + std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(1.0 / cap));
+            waitUntil(target);
+        }
+
+        auto now = Clock::now();
+        float ms = std::chrono::duration<float, std::milli>(now - lastFrameEnd).count();
+        lastFrameEnd = now;
+
+        frameTimes[historyPos] = ms;
+        historyPos = (historyPos + 1) % historySize;
+        if (historyCount < historySize) historyCount++;
+    }
+
+    // Cap currently in effect (0 = uncapped)
+    float ActiveCap() const
+    {
+        if (throttleInBackground && !glfwGetWindowAttrib(window, GLFW_FOCUSED))
+            return fpsCap > 0.0f ? std::min(fpsCap, backgroundFps) : backgroundFps;
+        return fpsCap;
+    }
+
+    // Frame-time statistics over the history window, in milliseconds
+    float AverageFrameMs() const
+    {
+        if (historyCount == 0) return 0.0f;
+        double sum = 0.0;
+        for (int i = 0; i < historyCount; i++) sum += frameTimes[i];
+        return (float)(sum / historyCount);
+    }
+
+    // Standard deviation of the frame time
+    float JitterMs() const
+    {
+        if (historyCount < 2) return 0.0f;
+        float avg = AverageFrameMs();
+        double var = 0.0;
+        for (int i = 0; i < historyCount; i++) {
+            double d = frameTimes[i] - avg;
+            var += d * d;
+        }
+        return (float)std::sqrt(var / (historyCount - 1));
+    }
+
+    // Worst distance of a frame from the average
+    float MaxDeviationMs() const
+    {
+        float avg = AverageFrameMs();
+        float worst = 0.0f;
+        for (int i = 0; i < historyCount; i++)
+            worst = std::max(worst, std::fabs(frameTimes[i] - avg));
+        return worst;
+    }
+
+    // Frame times in chronological order, for ImGui::PlotLines
+    const float* History() const { return frameTimes.data(); }
+    int HistoryOffset() const { return historyPos; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    GLFWwindow* window = nullptr;
+    Clock::time_point lastFrameEnd;
+
+    std::vector<float> frameTimes;
+    int historyPos = 0;
+    int historyCount = 0;
+
+    // How early to wake up from sleep and spin instead; grows with the observed oversleep
+    double spinMarginSec = 0.002;
+
+    void waitUntil(Clock::time_point target)
+    {
+        auto sleepUntil = target - std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(spinMarginSec));
+        auto now = Clock::now();
+        if (now < sleepUntil) {
+            auto requested = sleepUntil - now;
+            std::this_thread::sleep_for(requested);
+            double oversleep = std::chrono::duration<double>(Clock::now() - now - requested).count();
+            // track the OS scheduler granularity, decaying slowly back towards 1 ms
+            spinMarginSec = std::max(0.001, std::max(oversleep * 1.25, spinMarginSec * 0.99));
+        }
+        while (Clock::now() < target)
+            std::this_thread::yield();
+    }
+};
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define FRUSTUM_SSE 1
+#endif
+
+// View frustum as six planes (a, b, c, d), inside when a*x + b*y + c*z + d >= 0.
+// Extracted from a clip matrix (Gribb/Hartmann); with projection * view * model
+// the planes are in model space and can be tested against model-space bounds.
+struct Frustum
+{
+    glm::vec4 planes[6];
+
+    static Frustum FromMatrix(const glm::mat4& m)
+    {
+        // glm is column major: row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+        glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+        Frustum f;
+        f.planes[0] = row3 + row0;   // left
+        f.planes[1] = row3 - row0;   // right
+        f.planes[2] = row3 + row1;   // bottom
+        f.planes[3] = row3 - row1;   // top
+        f.planes[4] = row3 + row2;   // near
+        f.planes[5] = row3 - row2;   // far
+        for (auto& p : f.planes) p /= glm::length(glm::vec3(p));
+        return f;
+    }
+};
+
+// Axis-aligned boxes in structure-of-arrays layout, padded to a multiple of 4
+// so the SIMD test can always load full lanes
+class AabbSoA
+{
+public:
+    void Clear()
+    {
+        minX.clear(); minY.clear(); minZ.clear();
+        maxX.clear(); maxY.clear(); maxZ.clear();
+        count = 0;
+    }
+
+    void Add(const glm::vec3& bmin, const glm::vec3& bmax)
+    {
+        // overwrite the padding, then pad again
+        resize(count);
+        minX.push_back(bmin.x); minY.push_back(bmin.y); minZ.push_back(bmin.z);
+        maxX.push_back(bmax.x); maxY.push_back(bmax.y); maxZ.push_back(bmax.z);
+        count++;
+        resize((count + 3) & ~size_t(3));
+    }
+
+    size_t Size() const { return count; }
+
+    // visible[i] = 1 when box i intersects the frustum (conservative: corner cases near
+    // the frustum edges may be kept); returns the number of culled boxes
+    int Cull(const Frustum& frustum, std::vector<unsigned char>& visible) const
+    {
+        visible.resize(minX.size());
+        int culled = 0;
+        for (size_t i = 0; i < count; i += 4) {
+            int outsideMask = 0;
+#ifdef FRUSTUM_SSE
+            __m128 outside = _mm_setzero_ps();
+            for (const glm::vec4& p : frustum.planes) {
+                // the box corner furthest along the plane normal
+                __m128 x = _mm_loadu_ps(p.x > 0.0f ? &maxX[i] : &minX[i]);
+                __m128 y = _mm_loadu_ps(p.y > 0.0f ? &maxY[i] : &minY[i]);
+                __m128 z = _mm_loadu_ps(p.z > 0.0f ? &maxZ[i] : &minZ[i]);
+                __m128 d = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(p.x)), _mm_mul_ps(y, _mm_set1_ps(p.y))),
+                    _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(p.z)), _mm_set1_ps(p.w)));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(d, _mm_setzero_ps()));
+            }
+            outsideMask = _mm_movemask_ps(outside);
+#else
+            for (int lane = 0; lane < 4; lane++) {
+                size_t k = i + lane;
+                for (const glm::vec4& p : frustum.planes) {
+                    float d = p.x * (p.x > 0.0f ? maxX[k] : minX[k])
+                        + p.y * (p.y > 0.0f ? maxY[k] : minY[k])
+                        + p.z * (p.z > 0.0f ? maxZ[k] : minZ[k]) + p.w;
+                    if (d < 0.0f) {
+                        outsideMask |= 1 << lane;
+                        break;
+                    }
+                }
+            }
+#endif
+            for (int lane = 0; lane < 4 && i + lane < count; lane++) {
+                bool out = (outsideMask >> lane) & 1;
+                visible[i + lane] = out ? 0 : 1;
+                culled += out;
+            }
+        }
+        return culled;
+    }
+
+private:
+    std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+    size_t count = 0;
+
+    void resize(size_t n)
+    {
+        // padding boxes are empty and far outside, they never count as visible
+        minX.resize(n, 1e30f); minY.resize(n, 1e30f); minZ.resize(n, 1e30f);
+        maxX.resize(n, 1e30f); maxY.resize(n, 1e30f); maxZ.resize(n, 1e30f);
+    }
+};
+
+#endif
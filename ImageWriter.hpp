@@ -0,0 +1,181 @@
+#ifndef IMAGE_WRITER_H
+#define IMAGE_WRITER_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Minimal PNG encoder (8-bit RGB/RGBA, no external dependencies).
+// Image data goes into uncompressed deflate blocks, so encoding is a plain copy;
+// rows can be streamed in any number of calls, which keeps memory bounded for huge images.
+class PngWriter
+{
+public:
+    ~PngWriter() { Close(); }
+
+    bool Open(const std::string& path, int width, int height, int channels)
+    {
+        file = fopen(path.c_str(), "wb");
+        if (!file) {
+            std::cerr << "PNG: cannot write " << path << std::endl;
+            return false;
+        }
+        this->width = width;
+        this->height = height;
+        this->channels = channels;
+        rowsWritten = 0;
+        adler = 1;
+
+        static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        fwrite(signature, 1, 8, file);
+
+        std::vector<unsigned char> ihdr;
+        put32(ihdr, width);
+        put32(ihdr, height);
+        ihdr.push_back(8);                          // bit depth
+        ihdr.push_back(channels == 4 ? 6 : 2);      // color type: RGBA or RGB
+        ihdr.push_back(0);                          // deflate
+        ihdr.push_back(0);                          // adaptive filtering
+        ihdr.push_back(0);                          // no interlace
+        chunk("IHDR", ihdr);
+
+        // zlib header: deflate, 32K window, no preset dictionary
+        std::vector<unsigned char> start = { 0x78, 0x01 };
+        chunk("IDAT", start);
+        return true;
+    }
+
+    // Append rows, top to bottom; data is rows * width * channels bytes
+    void WriteRows(const unsigned char* data, int rows)
+    {
+        if (!file) return;
+        size_t rowBytes = (size_t)width * channels;
+        std::vector<unsigned char> raw;
+        raw.reserve(rows * (rowBytes + 1));
+        for (int r = 0; r < rows; r++) {
+            raw.push_back(0);                       // filter: none
+            raw.insert(raw.end(), data + r * rowBytes, data + (r + 1) * rowBytes);
+        }
+        updateAdler(raw);
+
+        std::vector<unsigned char> idat;
+        idat.reserve(raw.size() + (raw.size() / 65535 + 1) * 5);
+        for (size_t pos = 0; pos < raw.size(); pos += 65535) {
+            size_t len = std::min<size_t>(65535, raw.size() - pos);
+            idat.push_back(0);                      // stored block, not final
+            idat.push_back(len & 0xFF);
+            idat.push_back((len >> 8) & 0xFF);
+            idat.push_back(~len & 0xFF);
+            idat.push_back((~len >> 8) & 0xFF);
+            idat.insert(idat.end(), raw.begin() + pos, raw.begin() + pos + len);
+        }
+        chunk("IDAT", idat);
+        rowsWritten += rows;
+    }
+
+    bool Close()
+    {
+        if (!file) return false;
+        if (rowsWritten != height)
+            std::cerr << "PNG: wrote " << rowsWritten << " of " << height << " rows" << std::endl;
+
+        // empty final stored block and the zlib checksum
+        std::vector<unsigned char> end = { 1, 0, 0, 0xFF, 0xFF };
+        put32(end, adler);
+        chunk("IDAT", end);
+        chunk("IEND", {});
+        bool ok = ferror(file) == 0;
+        fclose(file);
+        file = nullptr;
+        return ok;
+    }
+
+private:
+    FILE* file = nullptr;
+    int width = 0, height = 0, channels = 3;
+    int rowsWritten = 0;
+    uint32_t adler = 1;
+
+    static void put32(std::vector<unsigned char>& v, uint32_t x)
+    {
+        v.push_back((x >> 24) & 0xFF);
+        v.push_back((x >> 16) & 0xFF);
+        v.push_back((x >> 8) & 0xFF);
+        v.push_back(x & 0xFF);
+    }
+
+    static uint32_t crc32(const unsigned char* data, size_t len, uint32_t crc)
+    {
+        // built once, thread-safe: PNGs are encoded on several workers at a time
+        static const std::array<uint32_t, 256> table = [] {
+            std::array<uint32_t, 256> t;
+            for (uint32_t n = 0; n < 256; n++) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                t[n] = c;
+            }
+            return t;
+        }();
+        for (size_t i = 0; i < len; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return crc;
+    }
+
+    void updateAdler(const std::vector<unsigned char>& data)
+    {
+        uint32_t a = adler & 0xFFFF, b = adler >> 16;
+        for (size_t i = 0; i < data.size(); ) {
+            size_t n = std::min<size_t>(5552, data.size() - i);   // largest run without overflow
+            for (size_t k = 0; k < n; k++, i++) {
+                a += data[i];
+                b += a;
+            }
+            a %= 65521;
+            b %= 65521;
+        }
+        adler = (b << 16) | a;
+    }
+
+    void chunk(const char* type, const std::vector<unsigned char>& data)
+    {
+        std::vector<unsigned char> header;
+        put32(header, (uint32_t)data.size());
+        fwrite(header.data(), 1, 4, file);
+        fwrite(type, 1, 4, file);
+        if (!data.empty()) fwrite(data.data(), 1, data.size(), file);
+        uint32_t crc = crc32((const unsigned char*)type, 4, 0xFFFFFFFFu);
+        crc = crc32(data.data(), data.size(), crc) ^ 0xFFFFFFFFu;
+        std::vector<unsigned char> footer;
+        put32(footer, crc);
+        fwrite(footer.data(), 1, 4, file);
+    }
+};
+
+// Write a whole image; flipY for bottom-up data coming from glReadPixels
+inline bool writePng(const std::string& path, int width, int height, int channels,
+    const unsigned char* data, bool flipY)
+{
+    PngWriter png;
+    if (!png.Open(path, width, height, channels)) return false;
+    size_t rowBytes = (size_t)width * channels;
+    if (!flipY) {
+        png.WriteRows(data, height);
+    }
+    else {
+        // flip in batches of rows to keep the number of chunks low
+        const int batch = 64;
+        std::vector<unsigned char> rows(batch * rowBytes);
+        for (int y = 0; y < height; y += batch) {
+            int n = std::min(batch, height - y);
+            for (int r = 0; r < n; r++)
+                std::copy_n(data + (size_t)(height - 1 - y - r) * rowBytes, rowBytes, rows.begin() + r * rowBytes);
+            png.WriteRows(rows.data(), n);
+        }
+    }
+    return png.Close();
+}
+
+#endif
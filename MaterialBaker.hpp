@@ -0,0 +1,259 @@
+#ifndef MATERIAL_BAKER_H
+#define MATERIAL_BAKER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "DiskCache.hpp"
+#include "MaterialTable.hpp"
+#include "ShaderVariants.hpp"
+#include "Trace.hpp"
+
+// Bakes procedural materials into mipmapped textures over the UV rectangle of
+// the meshes that use them. The result only depends on the material record of
+// the selected choice and the resolution, so every (material, choice) pair is baked
+// once, on first use, and then shading is a single texture fetch.
+// Baked textures are also kept on disk, keyed by everything that determines
+// their texels, and mapped back in on later runs.
+class MaterialBaker
+{
+public:
+    int size = 1024;
+
+    // Optional CPU generator: fills size x size RGBA8 texels (rows bottom-up) and
+    // returns true, or returns false to fall back to the GPU bake
+    std::function<bool(int materialID, int choice, const glm::vec4& uvRect, int size,
+        std::vector<unsigned char>& rgba)> cpuBake;
+    // Version of the CPU generator's code, part of the cache key of its textures
+    int cpuBakeVersion = 0;
+
+    bool diskCache = true;
+    std::string cacheDir = "cache/materials";
+
+    MaterialBaker() = default;
+    MaterialBaker(const MaterialBaker&) = delete;
+    MaterialBaker& operator=(const MaterialBaker&) = delete;
+    ~MaterialBaker() { Destroy(); }
+
+    // bakePrograms draw materialColor(uv) of record uMaterialIndex over uUvRect, one variant
+    // per pattern; bakeSource is their fragment source, which holds the noise code.
+    // Called again when the shaders change: the textures baked so far are dropped.
+    void Init(ShaderVariants* bakePrograms, const std::string& bakeSource, const MaterialTable* materials)
+    {
+        Clear();
+        programs = bakePrograms;
+        table = materials;
+        sourceHash = fnv1a(bakeSource);
+        if (!fbo) glGenFramebuffers(1, &fbo);
+        if (!vao) glGenVertexArrays(1, &vao);     // the full-screen triangle has no attributes
+    }
+
+    void Destroy()
+    {
+        Clear();
+        if (fbo) glDeleteFramebuffers(1, &fbo);
+        if (vao) glDeleteVertexArrays(1, &vao);
+        fbo = vao = 0;
+    }
+
+    // Drop every baked texture (e.g. after a resolution change)
+    void Clear()
+    {
+        for (auto& t : textures) glDeleteTextures(1, &t.second);
+        textures.clear();
+    }
+
+    // Delete every entry of the disk cache, so the next Get() bakes again
+    void PurgeDisk()
+    {
+        std::error_code ec;
+        for (auto& entry : std::filesystem::directory_iterator(cacheDir, ec))
+            if (entry.path().extension() == ".tex") std::filesystem::remove(entry.path(), ec);
+    }
+
+    // Texture of choice `choice` for mesh material `materialID` (1..5); baked on first use
+    GLuint Get(int materialID, int choice, const glm::vec4& uvRect)
+    {
+        auto key = std::make_pair(materialID, choice);
+        auto it = textures.find(key);
+        if (it != textures.end()) return it->second;
+
+        GLuint texture = load(materialID, choice, uvRect);
+        if (!texture) {
+            texture = bake(materialID, choice, uvRect);
+            if (diskCache) store(materialID, choice, uvRect, texture);
+        }
+        textures[key] = texture;
+        return texture;
+    }
+
+    // Load a texture from the disk cache, if it is there, without baking; true when resident
+    bool Preload(int materialID, int choice, const glm::vec4& uvRect)
+    {
+        auto key = std::make_pair(materialID, choice);
+        if (textures.count(key)) return true;
+        GLuint texture = load(materialID, choice, uvRect);
+        if (texture) textures[key] = texture;
+        return texture != 0;
+    }
+
+    int BakedCount() const { return (int)textures.size(); }
+    double LastBakeMs() const { return lastBakeMs; }
+    int DiskHits() const { return diskHits; }
+    int DiskWrites() const { return diskWrites; }
+    double DiskLoadMs() const { return diskLoadMs; }
+
+private:
+    ShaderVariants* programs = nullptr;
+    const MaterialTable* table = nullptr;
+    GLuint fbo = 0;
+    GLuint vao = 0;
+    std::map<std::pair<int, int>, GLuint> textures;
+    double lastBakeMs = 0.0;
+    uint64_t sourceHash = 0;
+    int diskHits = 0;
+    int diskWrites = 0;
+    double diskLoadMs = 0.0;
+
+    struct CacheHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t size;
+        uint32_t reserved;
+        uint64_t key;
+    };
+
+    // Everything the texels depend on: generator (and its version), shader source (noise
+    // code), material record, material, choice, UV rectangle and resolution
+    uint64_t cacheKey(int materialID, int choice, const glm::vec4& uvRect) const
+    {
+        uint64_t h = fnv1a(&sourceHash, sizeof(sourceHash));
+        int generator[2] = { cpuBake ? 1 : 0, cpuBake ? cpuBakeVersion : 0 };
+        h = fnv1a(generator, sizeof(generator), h);
+        uint64_t record = table->Hash(table->Index(materialID, choice));
+        h = fnv1a(&record, sizeof(record), h);
+        int ints[3] = { materialID, choice, size };
+        h = fnv1a(ints, sizeof(ints), h);
+        return fnv1a(&uvRect[0], sizeof(float) * 4, h);
+    }
+
+    std::string cachePath(uint64_t key) const { return cacheDir + "/" + hashToString(key) + ".tex"; }
+
+    GLuint createTexture()
+    {
+        GLuint texture = 0;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        return texture;
+    }
+
+    // Upload straight from the mapped file; 0 on a miss or a stale/corrupt entry
+    GLuint load(int materialID, int choice, const glm::vec4& uvRect)
+    {
+        if (!diskCache) return 0;
+        TraceScope trace("Load baked material", "bake");
+        auto start = std::chrono::steady_clock::now();
+        uint64_t key = cacheKey(materialID, choice, uvRect);
+        MappedFile file;
+        if (!file.Open(cachePath(key))) return 0;
+
+        size_t payload = (size_t)size * size * 4;
+        CacheHeader header;
+        if (file.Size() != sizeof(header) + payload) return 0;
+        memcpy(&header, file.Data(), sizeof(header));
+        if (memcmp(header.magic, "MTEX", 4) != 0 || header.version != 1 ||
+            header.size != (uint32_t)size || header.key != key)
+            return 0;
+
+        GLuint texture = createTexture();
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, file.Data() + sizeof(header));
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        diskHits++;
+        diskLoadMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return texture;
+    }
+
+    void store(int materialID, int choice, const glm::vec4& uvRect, GLuint texture)
+    {
+        TraceScope trace("Store baked material", "bake");
+        std::vector<unsigned char> pixels((size_t)size * size * 4);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        CacheHeader header = { { 'M', 'T', 'E', 'X' }, 1, (uint32_t)size, 0, cacheKey(materialID, choice, uvRect) };
+        if (writeCacheFile(cachePath(header.key), &header, sizeof(header), pixels.data(), pixels.size()))
+            diskWrites++;
+        else
+            std::cerr << "Material cache: cannot write " << cachePath(header.key) << std::endl;
+    }
+
+    GLuint bake(int materialID, int choice, const glm::vec4& uvRect)
+    {
+        TraceScope trace("Bake material", "bake");
+        auto start = std::chrono::steady_clock::now();
+
+        GLint previousFbo = 0, viewport[4];
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFbo);
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        GLint previousProgram = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+
+        GLuint texture = createTexture();
+        std::vector<unsigned char> pixels;
+        if (cpuBake && cpuBake(materialID, choice, uvRect, size, pixels)) {
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+            glGenerateMipmap(GL_TEXTURE_2D);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            lastBakeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            return texture;
+        }
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+        glViewport(0, 0, size, size);
+        glDisable(GL_DEPTH_TEST);
+
+        int index = table->Index(materialID, choice);
+        GLuint program = programs->Get(table->Record(index).pattern);
+        glUseProgram(program);
+        glUniform4fv(glGetUniformLocation(program, "uUvRect"), 1, &uvRect[0]);
+        glUniform1i(glGetUniformLocation(program, "uMaterialIndex"), index);
+        glBindVertexArray(vao);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glEnable(GL_DEPTH_TEST);
+        glBindFramebuffer(GL_FRAMEBUFFER, previousFbo);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        glUseProgram(previousProgram);
+
+        glFinish();
+        lastBakeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return texture;
+    }
+};
+
+#endif
@@ -0,0 +1,351 @@
+#ifndef MATERIAL_NOISE_H
+#define MATERIAL_NOISE_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "MaterialTable.hpp"
+#include "SimdLanes.hpp"
+#include "ThreadPool.hpp"
+
+// CPU port of the procedural materials of the scene shader (materialLibSrc in
+// main.cpp): the marble turbulence and the wood fbm/musgrave noise, written once
+// over simd lane types and run 1, 4 or 8 pixels wide. Textures are generated in
+// tiles over a thread pool, without any GPU. Every octave is evaluated, like the
+// shader with FULL_OCTAVES (--cpu-bake turns the adaptive octaves off).
+
+// Version of the texels the port generates, hashed into the keys of the baked
+// material cache: bump it whenever a change here changes the output
+const int materialNoiseVersion = 2;     // 2: n31 corners mixed like the shader
+
+// The GLSL functions, one lane type at a time; names follow the shader
+template<class F>
+struct MaterialNoise
+{
+    struct V3 { F x, y, z; };
+
+    // ---- marble
+    static F hash(F px, F py)
+    {
+        F h = px * 127.1f + py * 311.7f;
+        return simd::vfract(F(simd::vsin(h) * 43758.5453123f));
+    }
+
+    static F noise(F px, F py)
+    {
+        F ix = simd::vfloor(px), iy = simd::vfloor(py);
+        F fx = px - ix, fy = py - iy;
+        F ux = fx * fx * (3.0f - 2.0f * fx);
+        F uy = fy * fy * (3.0f - 2.0f * fy);
+        return simd::vmix(
+            simd::vmix(hash(ix, iy), hash(ix + 1.0f, iy), ux),
+            simd::vmix(hash(ix, iy + 1.0f), hash(ix + 1.0f, iy + 1.0f), ux),
+            uy);
+    }
+
+    static F turbulence(F px, F py, int octaves)
+    {
+        F t = F(0.0f);
+        float scale = 2.0f;
+        for (int i = 0; i < octaves; i++) {
+            t = t + simd::vabs(F(noise(px * scale, py * scale) - 0.5f)) / scale;
+            scale *= 2.5f;
+        }
+        return t;
+    }
+
+    static F marbleVeins(F px, F py, int octaves)
+    {
+        F t = turbulence(px, py, octaves);
+        F veins = simd::vsin(F(px * 2.0f + t * 80.0f));
+        return simd::vsmoothstep(0.9f, 0.95f, veins);
+    }
+
+    // ---- wood
+    static F h31(F x, F y, F z)
+    {
+        x = simd::vfract(F(x * 0.1031f));
+        y = simd::vfract(F(y * 0.1031f));
+        z = simd::vfract(F(z * 0.1031f));
+        F d = x * (y + 333.3456f) + y * (z + 333.3456f) + z * (x + 333.3456f);
+        x = x + d; y = y + d; z = z + d;
+        return simd::vfract(F((x + y) * z));
+    }
+
+    static F h21(F x, F y) { return h31(x, y, x); }
+
+    static F n31(F px, F py, F pz)
+    {
+        F ipx = simd::vfloor(px), ipy = simd::vfloor(py), ipz = simd::vfloor(pz);
+        F fx = px - ipx, fy = py - ipy, fz = pz - ipz;
+        fx = fx * fx * (3.0f - 2.0f * fx);
+        fy = fy * fy * (3.0f - 2.0f * fy);
+        fz = fz * fz * (3.0f - 2.0f * fz);
+
+        F d = ipx * 7.0f + ipy * 157.0f + ipz * 113.0f;
+        F h[4] = { F(0.0f) + d, F(157.0f) + d, F(113.0f) + d, F(270.0f) + d };
+        for (F& hk : h) {
+            F a = simd::vfract(F(simd::vsin(hk) * 43758.545f));
+            F b = simd::vfract(F(simd::vsin(F(hk + 7.0f)) * 43758.545f));
+            hk = simd::vmix(a, b, fx);
+        }
+        // h.xy = mix(h.xz, h.yw, p.y): the +157 corners are the y neighbours
+        F hx = simd::vmix(h[0], h[1], fy);
+        F hy = simd::vmix(h[2], h[3], fy);
+        return simd::vmix(hx, hy, fz);
+    }
+
+    static F fbm(F px, F py, F pz, int octaves, float roughness)
+    {
+        F sum = F(0.0f);
+        float amp = 1.0f, tot = 0.0f;
+        roughness = std::min(std::max(roughness, 0.0f), 1.0f);
+        for (int i = 0; i < octaves; i++) {
+            sum = sum + amp * n31(px, py, pz);
+            tot += amp;
+            amp *= roughness;
+            px = px * 2.0f; py = py * 2.0f; pz = pz * 2.0f;
+        }
+        return sum / tot;
+    }
+
+    static glm::vec3 randomPos(float seed)
+    {
+        return glm::vec3(MaterialNoise<float>::h21(seed, 0.0f), MaterialNoise<float>::h21(seed, 1.0f),
+            MaterialNoise<float>::h21(seed, 2.0f)) * 1e2f + 1e2f;
+    }
+
+    static F fbmDistorted(F px, F py, F pz, int octaves)
+    {
+        static const glm::vec3 r0 = randomPos(0.0f), r1 = randomPos(1.0f), r2 = randomPos(2.0f);
+        F nx = n31(px + r0.x, py + r0.y, pz + r0.z);
+        F ny = n31(px + r1.x, py + r1.y, pz + r1.z);
+        F nz = n31(px + r2.x, py + r2.y, pz + r2.z);
+        px = px + (nx * 2.0f - 1.0f) * 1.12f;
+        py = py + (ny * 2.0f - 1.0f) * 1.12f;
+        pz = pz + (nz * 2.0f - 1.0f) * 1.12f;
+        return fbm(px, py, pz, octaves, 0.5f);
+    }
+
+    static F musgraveFbm(F px, F py, F pz, float octaves, float dimension, float lacunarity)
+    {
+        F sum = F(0.0f);
+        float amp = 1.0f, m = std::pow(lacunarity, -dimension);
+        for (float i = 0.0f; i < octaves; i++) {
+            F n = n31(px, py, pz) * 2.0f - 1.0f;
+            sum = sum + n * amp;
+            amp *= m;
+            px = px * lacunarity; py = py * lacunarity; pz = pz * lacunarity;
+        }
+        return sum;
+    }
+
+    static V3 waveFbmX(F px, F py, F pz)
+    {
+        F n = px * 20.0f;
+        n = n + 0.4f * fbm(px * 3.0f, py * 3.0f, pz * 3.0f, 3, 3.0f);
+        return { simd::vsin(n) * 0.5f + 0.5f, py, pz };
+    }
+
+    static F remap01(F f, float in1, float in2)
+    {
+        return simd::vclamp(F((f - in1) / (in2 - in1)), F(0.0f), F(1.0f));
+    }
+
+    static V3 matWood(F px, F py, F pz, const glm::vec3* c, int octaves)
+    {
+        F n1 = fbmDistorted(px * 7.8f, py * 1.17f, pz * 1.17f, octaves);
+        n1 = simd::vmix(n1, F(1.0f), F(0.2f));
+        F m = n1 * 4.6f;
+        F n2 = simd::vmix(musgraveFbm(m, m, m, 8.0f, 0.0f, 2.5f), n1, F(0.85f));
+        V3 w = waveFbmX(px * 0.01f, py * 0.15f, pz * 0.15f);
+        F dirt = 1.0f - musgraveFbm(w.x, w.y, w.z, 15.0f, 0.26f, 2.4f) * 0.4f;
+        F grain = 1.0f - simd::vsmoothstep(0.2f, 1.0f, musgraveFbm(px * 500.0f, py * 6.0f, pz * 1.0f, 2.0f, 2.0f, 2.5f)) * 0.2f;
+        n2 = n2 * (dirt * grain);
+
+        F t1 = remap01(n2, 0.19f, 0.56f), t2 = remap01(n2, 0.56f, 1.0f);
+        return {
+            simd::vmix(simd::vmix(F(c[0].x), F(c[1].x), t1), F(c[2].x), t2),
+            simd::vmix(simd::vmix(F(c[0].y), F(c[1].y), t1), F(c[2].y), t2),
+            simd::vmix(simd::vmix(F(c[0].z), F(c[1].z), t1), F(c[2].z), t2) };
+    }
+
+    // Linear color of count pixels of one row; u padded to a multiple of the lane count
+    static void ShadeRow(const MaterialParams& params, const float* u, float v, int count, float* r, float* g, float* b)
+    {
+        const int lanes = simd::LaneCount<F>::value;
+        const glm::vec3* c = params.colors;
+        for (int x = 0; x < count; x += lanes) {
+            F uu = simd::vload<F>(u + x) * params.uvScale;
+            F vv = F(v * params.uvScale);
+            V3 color;
+            if (params.pattern == MaterialParams::Marble) {
+                F veins = marbleVeins(uu, vv, params.octaves);
+                color = { simd::vmix(F(c[0].x), F(c[1].x), veins), simd::vmix(F(c[0].y), F(c[1].y), veins),
+                    simd::vmix(F(c[0].z), F(c[1].z), veins) };
+            }
+            else if (params.pattern == MaterialParams::Wood) {
+                color = matWood(F((uu - 0.5f) * 2.0f), F((vv - 0.5f) * 2.0f), F(0.0f), c, params.octaves);
+            }
+            else {
+                color = { F(c[0].x), F(c[0].y), F(c[0].z) };
+            }
+            simd::vstore(r + x, color.x);
+            simd::vstore(g + x, color.y);
+            simd::vstore(b + x, color.z);
+        }
+    }
+};
+
+// Row kernels of the wide instruction sets, each compiled for its own target
+#ifdef SIMD_HAVE_AVX2
+SIMD_KERNEL_AVX2 inline void shadeMaterialRowAvx2(const MaterialParams& params, const float* u, float v, int count,
+    float* r, float* g, float* b)
+{
+    MaterialNoise<simd::Float8>::ShadeRow(params, u, v, count, r, g, b);
+}
+#endif
+#ifdef SIMD_HAVE_SSE41
+SIMD_KERNEL_SSE41 inline void shadeMaterialRowSse41(const MaterialParams& params, const float* u, float v, int count,
+    float* r, float* g, float* b)
+{
+    MaterialNoise<simd::Float4>::ShadeRow(params, u, v, count, r, g, b);
+}
+#endif
+
+// Shade one row with the given instruction set
+inline void shadeMaterialRow(simd::Isa isa, const MaterialParams& params, const float* u, float v, int count,
+    float* r, float* g, float* b)
+{
+#ifdef SIMD_HAVE_AVX2
+    if (isa == simd::Isa::AVX2) return shadeMaterialRowAvx2(params, u, v, count, r, g, b);
+#endif
+#ifdef SIMD_HAVE_SSE41
+    if (isa == simd::Isa::SSE41) return shadeMaterialRowSse41(params, u, v, count, r, g, b);
+#endif
+    (void)isa;
+    MaterialNoise<float>::ShadeRow(params, u, v, count, r, g, b);
+}
+
+// RGBA8 texture of size x size texels over uvRect (xy = min, zw = size), rows bottom-up
+// like glTexImage2D expects; the pool, when one is given, helps with the tiles
+inline void generateMaterialTexture(const MaterialParams& params, int size, const glm::vec4& uvRect,
+    std::vector<unsigned char>& rgba, ThreadPool* pool, simd::Isa isa, int tileSize = 64)
+{
+    rgba.resize((size_t)size * size * 4);
+    unsigned char* out = rgba.data();
+
+    auto tile = [&params, size, uvRect, out, isa](int x0, int y0, int w, int h) {
+        int padded = (w + 7) & ~7;
+        std::vector<float> u(padded), r(padded), g(padded), b(padded);
+        for (int i = 0; i < padded; i++)
+            u[i] = uvRect.x + (std::min(x0 + i, size - 1) + 0.5f) / size * uvRect.z;
+        for (int y = y0; y < y0 + h; y++) {
+            float v = uvRect.y + (y + 0.5f) / size * uvRect.w;
+            shadeMaterialRow(isa, params, u.data(), v, padded, r.data(), g.data(), b.data());
+            unsigned char* dst = out + ((size_t)y * size + x0) * 4;
+            for (int i = 0; i < w; i++) {
+                float c[3] = { r[i], g[i], b[i] };
+                for (int k = 0; k < 3; k++) {
+                    if (params.pattern == MaterialParams::Wood) c[k] = std::pow(c[k], 0.4545f);
+                    dst[i * 4 + k] = (unsigned char)(std::min(std::max(c[k], 0.0f), 1.0f) * 255.0f + 0.5f);
+                }
+                dst[i * 4 + 3] = 255;
+            }
+        }
+    };
+
+    // tiles are claimed one at a time by the calling thread and by helper tasks on
+    // the pool; the caller only waits for this texture's tiles, never for other
+    // work queued on the pool (readback encodes), and runs them all itself if the
+    // pool is busy
+    struct Progress
+    {
+        std::atomic<int> next{ 0 };
+        int done = 0;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    const int columns = (size + tileSize - 1) / tileSize;
+    const int tileCount = columns * columns;
+    auto progress = std::make_shared<Progress>();
+    auto work = [tile, progress, columns, tileCount, tileSize, size] {
+        for (int i; (i = progress->next++) < tileCount;) {
+            int x = i % columns * tileSize, y = i / columns * tileSize;
+            tile(x, y, std::min(tileSize, size - x), std::min(tileSize, size - y));
+            std::lock_guard<std::mutex> lock(progress->mutex);
+            if (++progress->done == tileCount) progress->finished.notify_all();
+        }
+    };
+
+    if (pool)
+        for (int i = 0; i < std::min(pool->Size(), tileCount - 1); i++) pool->Submit(work);
+    work();
+    std::unique_lock<std::mutex> lock(progress->mutex);
+    progress->finished.wait(lock, [&] { return progress->done == tileCount; });
+}
+
+// Megapixels per second of every available instruction set, one thread and the whole
+// pool, plus the largest difference of the wide kernels against the scalar one, on
+// the first marble and the first wood record of the table. This only compares the
+// port with itself; --cpu-bake-check compares it with the shader.
+inline void runNoiseBenchmark(ThreadPool& pool, const MaterialTable& table, int size = 256)
+{
+    std::vector<simd::Isa> isas = { simd::Isa::Scalar };
+    simd::Isa best = simd::BestIsa();
+    if (best >= simd::Isa::SSE41) isas.push_back(simd::Isa::SSE41);
+    if (best >= simd::Isa::AVX2) isas.push_back(simd::Isa::AVX2);
+
+    const glm::vec4 uvRect(0.0f, 0.0f, 1.0f, 1.0f);
+    const double megapixels = (double)size * size / 1e6;
+
+    printf("Noise benchmark: %dx%d texels, %d worker threads\n", size, size, pool.Size());
+    printf("%-8s %-16s %10s %10s %8s %9s\n", "material", "path", "MP/s", "MP/s/core", "speedup", "max diff");
+    for (int pattern : { MaterialParams::Marble, MaterialParams::Wood }) {
+        int index = 1;
+        while (index < table.Count() && table.Record(index).pattern != pattern) index++;
+        if (index == table.Count()) continue;
+        const MaterialParams& params = table.Record(index);
+        const char* name = MaterialTable::PatternName(pattern);
+        std::vector<unsigned char> reference, pixels;
+        double scalarRate = 0.0;
+
+        auto run = [&](simd::Isa isa, ThreadPool* threads, std::vector<unsigned char>& out) {
+            auto start = std::chrono::steady_clock::now();
+            generateMaterialTexture(params, size, uvRect, out, threads, isa);
+            double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            return megapixels / sec;
+        };
+        auto report = [&](const char* path, double rate, int cores) {
+            int maxDiff = 0;
+            for (size_t i = 0; i < pixels.size(); i++)
+                maxDiff = std::max(maxDiff, std::abs((int)pixels[i] - (int)reference[i]));
+            printf("%-8s %-16s %10.3f %10.3f %7.1fx %9d\n", name, path, rate, rate / cores, rate / scalarRate, maxDiff);
+        };
+
+        scalarRate = run(simd::Isa::Scalar, nullptr, reference);
+        pixels = reference;
+        report("scalar", scalarRate, 1);
+        for (simd::Isa isa : isas) {
+            if (isa == simd::Isa::Scalar) continue;
+            double rate = run(isa, nullptr, pixels);
+            report(simd::IsaName(isa), rate, 1);
+        }
+        double rate = run(best, &pool, pixels);
+        char path[32];
+        snprintf(path, sizeof(path), "%s x%d threads", simd::IsaName(best), pool.Size());
+        report(path, rate, pool.Size());
+    }
+}
+
+#endif
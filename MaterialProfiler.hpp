@@ -0,0 +1,91 @@
+#ifndef MATERIAL_PROFILER_H
+#define MATERIAL_PROFILER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "RenderTarget.hpp"
+
+// GPU cost of material programs in isolation: a material bake program (a
+// full-screen triangle over a UV rectangle, shading one record of the
+// material table) is drawn into an offscreen target
+// of fixed size, many times, inside one GL_TIME_ELAPSED query.
+class MaterialProfiler
+{
+public:
+    int width = 1024;
+    int height = 1024;
+    int iterations = 20;
+
+    MaterialProfiler() = default;
+    MaterialProfiler(const MaterialProfiler&) = delete;
+    MaterialProfiler& operator=(const MaterialProfiler&) = delete;
+    ~MaterialProfiler() { Destroy(); }
+
+    bool Init()
+    {
+        if (!target.Create(width, height)) return false;
+        glGenVertexArrays(1, &vao);     // the full-screen triangle has no attributes
+        glGenQueries(1, &query);
+        return true;
+    }
+
+    void Destroy()
+    {
+        target.Destroy();
+        if (vao) glDeleteVertexArrays(1, &vao);
+        if (query) glDeleteQueries(1, &query);
+        vao = query = 0;
+    }
+
+    // Average GPU nanoseconds per pixel of one full-screen draw
+    double Measure(GLuint program, const glm::vec4& uvRect, int materialIndex)
+    {
+        begin(program, uvRect, materialIndex);
+        glDrawArrays(GL_TRIANGLES, 0, 3);   // warm-up: caches, lazy driver work
+        glFinish();
+
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        for (int i = 0; i < iterations; i++) glDrawArrays(GL_TRIANGLES, 0, 3);
+        glEndQuery(GL_TIME_ELAPSED);
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+        end();
+        return (double)ns / iterations / ((double)width * height);
+    }
+
+    // One draw, read back as RGBA8 rows bottom-up
+    void Render(GLuint program, const glm::vec4& uvRect, int materialIndex, std::vector<unsigned char>& rgba)
+    {
+        begin(program, uvRect, materialIndex);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        end();
+        target.ReadPixels(rgba, GL_RGBA);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+private:
+    RenderTarget target;
+    GLuint vao = 0;
+    GLuint query = 0;
+
+    void begin(GLuint program, const glm::vec4& uvRect, int materialIndex)
+    {
+        target.Bind();
+        glDisable(GL_DEPTH_TEST);
+        glUseProgram(program);
+        glUniform4fv(glGetUniformLocation(program, "uUvRect"), 1, &uvRect[0]);
+        glUniform1i(glGetUniformLocation(program, "uMaterialIndex"), materialIndex);
+        glBindVertexArray(vao);
+    }
+
+    void end()
+    {
+        glBindVertexArray(0);
+        glEnable(GL_DEPTH_TEST);
+    }
+};
+
+#endif
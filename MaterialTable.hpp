@@ -0,0 +1,194 @@
+#ifndef MATERIAL_TABLE_H
+#define MATERIAL_TABLE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "DiskCache.hpp"
+
+// Parameters of one material record: a pattern of the shader's material
+// library and what it is drawn with
+struct MaterialParams
+{
+    enum Pattern { Flat, Marble, Wood, PatternCount };
+    Pattern pattern = Flat;
+    float uvScale = 1.0f;
+    int octaves = 0;        // marble: turbulence octaves; wood: grain fbm octaves
+    glm::vec3 colors[3] = { glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f) };
+                            // flat: color; marble: base, vein; wood: base, mid, highlight
+};
+
+// The material records of the scene, loaded from a text file and uploaded once
+// into the Materials uniform block, which the material programs index with
+// uMaterialIndex. Programs are only specialized per pattern (ShaderVariants.hpp),
+// so editing or adding a record needs no shader rebuild.
+// Record 0 is the fallback of unknown materials.
+//
+// File format, one directive per line ('#' starts a comment):
+//   material <slot> <choice> flat <r g b>
+//   material <slot> <choice> marble <uv scale> <octaves> <base rgb> <vein rgb>
+//   material <slot> <choice> wood <uv scale> <octaves> <base rgb> <mid rgb> <highlight rgb>
+// slot: white, black, board, whiteSquares or blackSquares (mesh material IDs 1..5);
+// the choices of every slot are numbered 1..n. The uv scale must be positive and
+// there is at least one octave.
+class MaterialTable
+{
+public:
+    static const int maxRecords = 32;   // MAX_MATERIALS of the shaders
+    static const int slotCount = 6;     // mesh material IDs are 1..5
+
+    MaterialTable() = default;
+    MaterialTable(const MaterialTable&) = delete;
+    MaterialTable& operator=(const MaterialTable&) = delete;
+    ~MaterialTable() { Destroy(); }
+
+    bool Load(const std::string& path)
+    {
+        std::ifstream in(path);
+        if (!in) {
+            std::cerr << "Materials: cannot read " << path << std::endl;
+            return false;
+        }
+        MaterialParams fallback;
+        fallback.colors[0] = glm::vec3(0.0f, 1.0f, 0.0f);
+        records.assign(1, fallback);
+        indices.clear();
+
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(in, line)) {
+            lineNumber++;
+            line = line.substr(0, line.find('#'));
+            std::istringstream ss(line);
+            std::string directive, slotName, patternName;
+            if (!(ss >> directive)) continue;
+            int choice = 0;
+            if (directive != "material" || !(ss >> slotName >> choice >> patternName))
+                return parseError(path, lineNumber);
+
+            int slot = 1;
+            while (slot < slotCount && slotName != SlotName(slot)) slot++;
+            int pattern = 0;
+            while (pattern < MaterialParams::PatternCount && patternName != PatternName(pattern)) pattern++;
+            if (slot == slotCount || pattern == MaterialParams::PatternCount || choice < 1 ||
+                indices.count(std::make_pair(slot, choice)))
+                return parseError(path, lineNumber);
+
+            MaterialParams params;
+            params.pattern = (MaterialParams::Pattern)pattern;
+            if (params.pattern != MaterialParams::Flat &&
+                (!(ss >> params.uvScale >> params.octaves) || !(params.uvScale > 0.0f) || params.octaves < 1))
+                return parseError(path, lineNumber);
+            int colorCount = params.pattern == MaterialParams::Wood ? 3 : params.pattern == MaterialParams::Marble ? 2 : 1;
+            for (int c = 0; c < colorCount; c++)
+                if (!(ss >> params.colors[c].r >> params.colors[c].g >> params.colors[c].b))
+                    return parseError(path, lineNumber);
+            std::string extra;
+            if (ss >> extra) return parseError(path, lineNumber);   // more values than the pattern takes
+
+            if ((int)records.size() == maxRecords) {
+                std::cerr << "Materials: " << path << ": more than " << maxRecords - 1 << " materials" << std::endl;
+                return false;
+            }
+            indices[std::make_pair(slot, choice)] = (int)records.size();
+            records.push_back(params);
+        }
+
+        for (int slot = 1; slot < slotCount; slot++) {
+            int n = Choices(slot);
+            if (n == 0 || indices.upper_bound(std::make_pair(slot, n)) != indices.lower_bound(std::make_pair(slot + 1, 0))) {
+                std::cerr << "Materials: " << path << ": the choices of " << SlotName(slot)
+                    << " must be numbered 1..n" << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Upload the records into a uniform buffer bound to `binding`
+    void Init(GLuint binding)
+    {
+        // std140: three vec4 colors, then x = uv scale, y = octaves, z = pattern
+        struct GpuRecord { glm::vec4 colors[3]; glm::vec4 params; };
+        std::vector<GpuRecord> block(maxRecords);
+        for (size_t i = 0; i < records.size(); i++) {
+            const MaterialParams& p = records[i];
+            for (int c = 0; c < 3; c++) block[i].colors[c] = glm::vec4(p.colors[c], 1.0f);
+            block[i].params = glm::vec4(p.uvScale, (float)p.octaves, (float)p.pattern, 0.0f);
+        }
+        if (!ubo) glGenBuffers(1, &ubo);
+        glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(GpuRecord) * block.size(), block.data(), GL_STATIC_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, ubo);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    void Destroy()
+    {
+        if (ubo) glDeleteBuffers(1, &ubo);
+        ubo = 0;
+    }
+
+    // Record of (mesh material ID, choice); 0 (the fallback) for unknown pairs
+    int Index(int materialID, int choice) const
+    {
+        auto it = indices.find(std::make_pair(materialID, choice));
+        return it == indices.end() ? 0 : it->second;
+    }
+
+    const MaterialParams& Record(int index) const { return records[index]; }
+    int Count() const { return (int)records.size(); }
+
+    // Number of choices of a mesh material
+    int Choices(int materialID) const
+    {
+        int n = 0;
+        while (indices.count(std::make_pair(materialID, n + 1))) n++;
+        return n;
+    }
+
+    // Names used in the file
+    static const char* SlotName(int materialID)
+    {
+        static const char* names[slotCount] = { "", "white", "black", "board", "whiteSquares", "blackSquares" };
+        return materialID >= 0 && materialID < slotCount ? names[materialID] : "";
+    }
+
+    static const char* PatternName(int pattern)
+    {
+        static const char* names[MaterialParams::PatternCount] = { "flat", "marble", "wood" };
+        return pattern >= 0 && pattern < MaterialParams::PatternCount ? names[pattern] : "";
+    }
+
+    // Hash of a record's parameters, for the caches of what is generated from it
+    uint64_t Hash(int index) const
+    {
+        const MaterialParams& p = records[index];
+        int ints[2] = { p.pattern, p.octaves };
+        uint64_t h = fnv1a(ints, sizeof(ints));
+        h = fnv1a(&p.uvScale, sizeof(float), h);
+        for (const glm::vec3& c : p.colors) h = fnv1a(&c[0], sizeof(float) * 3, h);
+        return h;
+    }
+
+private:
+    std::vector<MaterialParams> records;
+    std::map<std::pair<int, int>, int> indices;     // (material ID, choice) -> record
+    GLuint ubo = 0;
+
+    static bool parseError(const std::string& path, int line)
+    {
+        std::cerr << "Materials: " << path << ":" << line << ": invalid material line" << std::endl;
+        return false;
+    }
+};
+
+#endif
@@ -8,6 +8,7 @@
 
 #include <glad/glad.h>
 #include "Shader.h"
+#include "Trace.hpp"
 #include <assimp/types.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -40,6 +41,9 @@ public:
     vector<Vertex> vertices;
     vector<GLuint> indices;
     int materialID = 0;
+    // Model-space bounding box, for frustum culling
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
 
     
     // Constructor
@@ -48,6 +52,13 @@ public:
         this->vertices = vertices;
         this->indices = indices;
 
+        if (!this->vertices.empty()) {
+            boundsMin = boundsMax = this->vertices[0].Position;
+            for (const Vertex& v : this->vertices) {
+                boundsMin = glm::min(boundsMin, v.Position);
+                boundsMax = glm::max(boundsMax, v.Position);
+            }
+        }
        
         this->setupMesh();
     }
@@ -72,6 +83,7 @@ private:
     // Initializes all the buffer objects/arrays
     void setupMesh()
     {
+        TraceScope trace("Mesh upload", "upload");
         // Create buffers/arrays
         glGenVertexArrays(1, &this->VAO);
         glGenBuffers(1, &this->VBO);
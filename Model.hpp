@@ -8,38 +8,60 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <functional>
 #include <string>
 #include <iostream>
 #include <vector>
 
 #include "Mesh.hpp"
+#include "Trace.hpp"
+#include "Frustum.hpp"
 
 class Model
 {
 public:
     //multiple sub-meshes
     std::vector<Mesh> meshes;
+    // Meshes skipped by the last culled Draw
+    int culledCount = 0;
+
+    static const int maxMaterialIDs = 6;    // material IDs are 1..5
+
+    // UV rectangle (xy = min, zw = size) covered by the meshes of a material
+    glm::vec4 MaterialUvRect(int materialID) const
+    {
+        return materialID >= 0 && materialID < maxMaterialIDs ? uvRects[materialID] : glm::vec4(0, 0, 1, 1);
+    }
 
     // Constructor loads the file
     Model(const std::string& path)
     {
         loadModel(path);
+        computeBounds();
     }
 
-    // Draw all sub-meshes 
-    void Draw(GLuint programID)
+    // Draw all sub-meshes; with a frustum (in model space), only the visible ones.
+    // materialTextures (indexed by material ID) are bound to unit 0 for baked shading.
+    void Draw(GLuint programID, const Frustum* frustum = nullptr, const GLuint* materialTextures = nullptr)
     {
+        culledCount = 0;
+        if (frustum) culledCount = bounds.Cull(*frustum, visible);
 
-        GLint materialLoc = glGetUniformLocation(programID, "uMaterialID");
         GLint timeLoc = glGetUniformLocation(programID, "iTime");
+        GLint uvRectLoc = glGetUniformLocation(programID, "uUvRect");
+        if (materialTextures) glActiveTexture(GL_TEXTURE0);
 
 
         float currentTime = (float)glfwGetTime(); 
 
-        for (auto& m : meshes)
+        for (size_t i = 0; i < meshes.size(); i++)
         {
-            // Set the uniform with the mesh's material ID
-            glUniform1i(materialLoc, m.materialID);
+            if (frustum && !visible[i]) continue;
+            Mesh& m = meshes[i];
+            if (materialTextures) {
+                glBindTexture(GL_TEXTURE_2D, materialTextures[m.materialID]);
+                glUniform4fv(uvRectLoc, 1, &uvRects[m.materialID][0]);
+            }
 
     
             glUniform1f(timeLoc, currentTime);
@@ -49,10 +71,36 @@ public:
         }
     }
 
+    // Draw the meshes grouped by material; useMaterial binds the program (or
+    // pipeline) of a material ID before its group and returns its name
+    void DrawByMaterial(const std::function<GLuint(int materialID)>& useMaterial, const Frustum* frustum = nullptr)
+    {
+        culledCount = 0;
+        if (frustum) culledCount = bounds.Cull(*frustum, visible);
+
+        for (int id = 0; id < maxMaterialIDs; id++)
+        {
+            if (materialGroups[id].empty()) continue;
+            GLuint programID = useMaterial(id);
+            for (size_t i : materialGroups[id])
+            {
+                if (frustum && !visible[i]) continue;
+                meshes[i].Draw(programID);
+            }
+        }
+    }
+
 private:
+    // bounds of every mesh, same order as meshes
+    AabbSoA bounds;
+    std::vector<unsigned char> visible;
+    glm::vec4 uvRects[maxMaterialIDs];
+    std::vector<size_t> materialGroups[maxMaterialIDs];   // mesh indices per material
+
     //Assimp to read the file
     void loadModel(const std::string& path)
     {
+        TraceScope trace("Import model", "import");
         Assimp::Importer importer;
         const aiScene* scene = importer.ReadFile(
             path,
@@ -72,6 +120,34 @@ private:
         processNode(scene->mRootNode, scene);
     }
 
+    // Culling bounds and per-material UV rectangles of the loaded meshes
+    void computeBounds()
+    {
+        bounds.Clear();
+        for (const Mesh& m : meshes) bounds.Add(m.boundsMin, m.boundsMax);
+
+        glm::vec2 uvMin[maxMaterialIDs], uvMax[maxMaterialIDs];
+        for (int id = 0; id < maxMaterialIDs; id++) {
+            uvMin[id] = glm::vec2(1e30f);
+            uvMax[id] = glm::vec2(-1e30f);
+        }
+        for (const Mesh& m : meshes) {
+            for (const Vertex& v : m.vertices) {
+                uvMin[m.materialID] = glm::min(uvMin[m.materialID], v.TexCoords);
+                uvMax[m.materialID] = glm::max(uvMax[m.materialID], v.TexCoords);
+            }
+        }
+        for (size_t i = 0; i < meshes.size(); i++) materialGroups[meshes[i].materialID].push_back(i);
+        for (int id = 0; id < maxMaterialIDs; id++) {
+            if (uvMin[id].x > uvMax[id].x) {
+                uvRects[id] = glm::vec4(0, 0, 1, 1);   // unused material
+                continue;
+            }
+            glm::vec2 size = glm::max(uvMax[id] - uvMin[id], glm::vec2(1e-4f));
+            uvRects[id] = glm::vec4(uvMin[id], size);
+        }
+    }
+
     void processNode(aiNode* node, const aiScene* scene)
     {
         for (unsigned int i = 0; i < node->mNumMeshes; i++)
@@ -0,0 +1,83 @@
+#ifndef NOISE_LUT_H
+#define NOISE_LUT_H
+
+#include <glad/glad.h>
+
+#include <cmath>
+#include <vector>
+
+// Lattice values for value noise, precomputed on the CPU. A texel (x, y)
+// holds the random values of the four lattice corners (x, y), (x+1, y),
+// (x, y+1), (x+1, y+1), so a 2D noise sample is one texelFetch plus the
+// smoothstep interpolation, and a 3D sample (slice z offset by z * (37, 17))
+// is two. The table wraps every NoiseLut::size lattice cells.
+// Inside the first tile the values are those of the 2D hash() in the shader,
+// computed in double precision, so the marble noise() only differs beyond it.
+// The wood n31() is another noise altogether: its slices come from this table,
+// while the analytic n31() hashes dot(cell, (7, 157, 113)), so LUT wood differs
+// from analytic wood everywhere.
+class NoiseLut
+{
+public:
+    static const int size = 256;
+
+    NoiseLut() = default;
+    NoiseLut(const NoiseLut&) = delete;
+    NoiseLut& operator=(const NoiseLut&) = delete;
+    ~NoiseLut() { Destroy(); }
+
+    // RGBA corner values, size x size texels
+    static void Generate(std::vector<float>& rgba)
+    {
+        std::vector<float> lattice((size_t)size * size);
+        for (int y = 0; y < size; y++)
+            for (int x = 0; x < size; x++) {
+                double h = std::sin(x * 127.1 + y * 311.7) * 43758.5453123;
+                lattice[(size_t)y * size + x] = (float)(h - std::floor(h));
+            }
+
+        rgba.resize((size_t)size * size * 4);
+        auto at = [&](int x, int y) { return lattice[(size_t)(y & (size - 1)) * size + (x & (size - 1))]; };
+        for (int y = 0; y < size; y++)
+            for (int x = 0; x < size; x++) {
+                float* t = &rgba[((size_t)y * size + x) * 4];
+                t[0] = at(x, y);
+                t[1] = at(x + 1, y);
+                t[2] = at(x, y + 1);
+                t[3] = at(x + 1, y + 1);
+            }
+    }
+
+    void Init()
+    {
+        std::vector<float> rgba;
+        Generate(rgba);
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, size, size, 0, GL_RGBA, GL_FLOAT, rgba.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    void Destroy()
+    {
+        if (texture) glDeleteTextures(1, &texture);
+        texture = 0;
+    }
+
+    // Bind to a texture unit; GL_TEXTURE0 is active again afterwards
+    void Bind(int unit) const
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+private:
+    GLuint texture = 0;
+};
+
+#endif
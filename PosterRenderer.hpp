@@ -0,0 +1,102 @@
+#ifndef POSTER_RENDERER_H
+#define POSTER_RENDERER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "RenderTarget.hpp"
+#include "ImageWriter.hpp"
+#include "Readback.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Tiled rendering of stills larger than GL_MAX_TEXTURE_SIZE or the available VRAM.
+// The image is split into tiles; each tile is drawn with a sub-frustum of the full
+// projection into one small offscreen target and read back. Tiles are produced one
+// tile row at a time, top to bottom, and streamed into the PNG, so memory stays
+// bounded by one tile row whatever the poster size.
+class PosterRenderer
+{
+public:
+    bool enabled = false;
+    int width = 0;
+    int height = 0;
+    int tileSize = 1024;
+    std::string outputPath = "poster.png";
+
+    // Projection of the tile covering pixels [x, x+w) x [y, y+h) (bottom-up) of the
+    // full image: scale and shift the tile's NDC rectangle onto [-1, 1]
+    glm::mat4 TileProjection(const glm::mat4& projection, int x, int y, int w, int h) const
+    {
+        float x0 = 2.0f * x / width - 1.0f, x1 = 2.0f * (x + w) / width - 1.0f;
+        float y0 = 2.0f * y / height - 1.0f, y1 = 2.0f * (y + h) / height - 1.0f;
+        glm::mat4 scale = glm::scale(glm::mat4(1.0f), glm::vec3(2.0f / (x1 - x0), 2.0f / (y1 - y0), 1.0f));
+        glm::mat4 shift = glm::translate(glm::mat4(1.0f), glm::vec3(-(x0 + x1) * 0.5f, -(y0 + y1) * 0.5f, 0.0f));
+        return scale * shift * projection;
+    }
+
+    // renderTile draws the scene with the given projection; target and viewport are already set
+    bool Run(const glm::mat4& projection, AsyncReadback& readback,
+        const std::function<void(const glm::mat4& tileProjection)>& renderTile)
+    {
+        GLint maxTexture = 0, maxRenderbuffer = 0, maxViewport[2] = { 0, 0 };
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTexture);
+        glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxRenderbuffer);
+        glGetIntegerv(GL_MAX_VIEWPORT_DIMS, maxViewport);
+        int tile = std::min({ tileSize, (int)maxTexture, (int)maxRenderbuffer, (int)maxViewport[0], (int)maxViewport[1] });
+        tile = std::max(16, tile);
+
+        RenderTarget target;
+        if (!target.Create(tile, tile)) return false;
+
+        PngWriter png;
+        if (!png.Open(outputPath, width, height, 3)) return false;
+
+        const size_t rowBytes = (size_t)width * 3;
+        std::vector<unsigned char> tileRow(rowBytes * tile);
+        int tilesX = (width + tile - 1) / tile, tilesY = (height + tile - 1) / tile;
+        auto start = std::chrono::steady_clock::now();
+
+        for (int ty = 0; ty < tilesY; ty++) {
+            // PNG rows go top to bottom, GL rows bottom to top
+            int y1 = height - ty * tile;
+            int y0 = std::max(0, y1 - tile);
+            int th = y1 - y0;
+
+            for (int tx = 0; tx < tilesX; tx++) {
+                int x0 = tx * tile;
+                int tw = std::min(tile, width - x0);
+
+                target.Bind();
+                glViewport(0, 0, tw, th);
+                renderTile(TileProjection(projection, x0, y0, tw, th));
+
+                // workers copy disjoint columns of the tile row
+                readback.Capture(target.fbo, tw, th, [&tileRow, rowBytes, x0](std::vector<unsigned char>& pixels, int w, int h) {
+                    for (int r = 0; r < h; r++)
+                        std::copy_n(&pixels[(size_t)(h - 1 - r) * w * 3], (size_t)w * 3, &tileRow[r * rowBytes + (size_t)x0 * 3]);
+                });
+                readback.Poll();
+            }
+            readback.Flush();
+            png.WriteRows(tileRow.data(), th);
+            std::cout << "\rPoster: tile row " << ty + 1 << "/" << tilesY << std::flush;
+        }
+        bool ok = png.Close();
+
+        double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "\nPoster: wrote " << outputPath << " (" << width << "x" << height << ", "
+            << tilesX * tilesY << " tiles of " << tile << "x" << tile << ") in " << total << " s, peak buffer "
+            << tileRow.size() / (1024.0 * 1024.0) << " MB" << std::endl;
+        return ok;
+    }
+};
+
+#endif
@@ -0,0 +1,297 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h>
+#include "imgui.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Frame profiler with nested named scopes.
+// CPU time comes from a high resolution clock, GPU time from GL_TIMESTAMP queries.
+// The queries are kept in a ring of frames and read back only once they are
+// available, so the CPU never waits for the GPU.
+class Profiler
+{
+public:
+    using Clock = std::chrono::high_resolution_clock;
+
+    static const int queryFrames = 3;     // frames in flight before a query slot is reused
+    static const int historySize = 240;   // frames kept for averages, percentiles and graphs
+
+    bool enabled = true;
+
+    // Optional sinks for every finished scope, e.g. the trace recorder
+    std::function<void(const char* name, Clock::time_point start, Clock::time_point end)> onCpuScope;
+    std::function<void(const char* name, GLuint64 startNs, GLuint64 endNs)> onGpuScope;
+
+    struct Scope
+    {
+        std::string name;
+        int depth = 0;
+        std::vector<float> cpuMs = std::vector<float>(historySize, 0.0f);
+        std::vector<float> gpuMs = std::vector<float>(historySize, 0.0f);
+        int cpuPos = 0, cpuCount = 0;
+        int gpuPos = 0, gpuCount = 0;
+        double cpuAccum = 0.0;            // time spent in this scope during the current frame
+        bool touched = false;
+    };
+
+    void Init()
+    {
+        GLint bits = 0;
+        glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+        gpuTimers = bits > 0;
+    }
+
+    bool HasGpuTimers() const { return gpuTimers; }
+
+    // Start a frame: collects finished GPU results and opens the root "Frame" scope
+    void BeginFrame()
+    {
+        active = enabled;   // toggling only takes effect between frames
+        if (!active) return;
+        for (int i = 1; i < queryFrames; i++)
+            collect(frames[(frameIndex + i) % queryFrames]);
+
+        frameIndex = (frameIndex + 1) % queryFrames;
+        FrameQueries& f = frames[frameIndex];
+        if (f.pending) {
+            collect(f);
+            if (f.pending) droppedGpuFrames++;   // still not ready: skip it rather than stall
+        }
+        f.used = 0;
+        f.samples.clear();
+        f.pending = false;
+
+        Begin("Frame");
+    }
+
+    void EndFrame()
+    {
+        if (stack.empty()) return;
+        while (!stack.empty()) End();
+        frames[frameIndex].pending = !frames[frameIndex].samples.empty();
+
+        for (auto& s : scopes) {
+            if (!s.touched) continue;
+            push(s.cpuMs, s.cpuPos, s.cpuCount, (float)s.cpuAccum);
+            s.cpuAccum = 0.0;
+            s.touched = false;
+        }
+    }
+
+    void Begin(const char* name)
+    {
+        if (!active) return;
+        int id = scopeIndex(name, (int)stack.size());
+        Open open;
+        open.scope = id;
+        open.cpuStart = Clock::now();
+        open.gpuSample = -1;
+        if (gpuTimers) {
+            FrameQueries& f = frames[frameIndex];
+            GpuSample sample;
+            sample.scope = id;
+            sample.begin = allocQuery(f);
+            sample.end = 0;
+            glQueryCounter(sample.begin, GL_TIMESTAMP);
+            open.gpuSample = (int)f.samples.size();
+            f.samples.push_back(sample);
+        }
+        stack.push_back(open);
+    }
+
+    void End()
+    {
+        if (stack.empty()) return;
+        Open open = stack.back();
+        stack.pop_back();
+        Scope& s = scopes[open.scope];
+        Clock::time_point now = Clock::now();
+        s.cpuAccum += std::chrono::duration<double, std::milli>(now - open.cpuStart).count();
+        s.touched = true;
+        if (onCpuScope) onCpuScope(s.name.c_str(), open.cpuStart, now);
+        if (open.gpuSample >= 0) {
+            FrameQueries& f = frames[frameIndex];
+            f.samples[open.gpuSample].end = allocQuery(f);
+            glQueryCounter(f.samples[open.gpuSample].end, GL_TIMESTAMP);
+        }
+    }
+
+    const std::vector<Scope>& Scopes() const { return scopes; }
+
+    // Average of the last frames, in milliseconds (-1 if the scope never ran)
+    float AverageMs(const char* name, bool gpu) const
+    {
+        for (auto& s : scopes) {
+            if (s.name != name) continue;
+            return average(gpu ? s.gpuMs : s.cpuMs, gpu ? s.gpuCount : s.cpuCount);
+        }
+        return -1.0f;
+    }
+
+    static float Percentile(const std::vector<float>& hist, int count, float p)
+    {
+        if (count == 0) return 0.0f;
+        std::vector<float> v(hist.begin(), hist.begin() + count);
+        size_t k = std::min(v.size() - 1, (size_t)(p * (v.size() - 1) + 0.5f));
+        std::nth_element(v.begin(), v.begin() + k, v.end());
+        return v[k];
+    }
+
+    // ImGui panel: table of scopes plus frame-time graphs
+    void DrawWindow(bool* open)
+    {
+        ImGui::SetNextWindowSize(ImVec2(640, 360), ImGuiCond_FirstUseEver);
+        if (!ImGui::Begin("Profiler", open)) {
+            ImGui::End();
+            return;
+        }
+        ImGui::Checkbox("Enabled", &enabled);
+        ImGui::SameLine();
+        ImGui::Text(gpuTimers ? "GPU timers: yes  (dropped %d)" : "GPU timers: not supported", droppedGpuFrames);
+
+        if (ImGui::BeginTable("scopes", 9, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit)) {
+            const char* headers[] = { "Scope", "CPU avg", "p50", "p95", "p99", "GPU avg", "p50", "p95", "p99" };
+            for (const char* h : headers) ImGui::TableSetupColumn(h);
+            ImGui::TableHeadersRow();
+            for (auto& s : scopes) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Indent(s.depth * 10.0f);
+                ImGui::TextUnformatted(s.name.c_str());
+                ImGui::Unindent(s.depth * 10.0f);
+                statColumns(s.cpuMs, s.cpuCount);
+                statColumns(s.gpuMs, s.gpuCount);
+            }
+            ImGui::EndTable();
+        }
+
+        if (!scopes.empty()) {
+            const Scope& frame = scopes[0];
+            char overlay[64];
+            snprintf(overlay, sizeof(overlay), "CPU frame %.2f ms", average(frame.cpuMs, frame.cpuCount));
+            ImGui::PlotLines("##cpu", frame.cpuMs.data(), historySize, frame.cpuPos, overlay, 0.0f, 33.0f, ImVec2(-1, 60));
+            snprintf(overlay, sizeof(overlay), "GPU frame %.2f ms", average(frame.gpuMs, frame.gpuCount));
+            ImGui::PlotLines("##gpu", frame.gpuMs.data(), historySize, frame.gpuPos, overlay, 0.0f, 33.0f, ImVec2(-1, 60));
+        }
+        ImGui::End();
+    }
+
+private:
+    struct GpuSample
+    {
+        int scope;
+        GLuint begin, end;
+    };
+
+    struct FrameQueries
+    {
+        std::vector<GLuint> pool;
+        size_t used = 0;
+        std::vector<GpuSample> samples;
+        bool pending = false;
+    };
+
+    struct Open
+    {
+        int scope;
+        Clock::time_point cpuStart;
+        int gpuSample;
+    };
+
+    bool active = false;
+    bool gpuTimers = false;
+    int droppedGpuFrames = 0;
+    std::vector<Scope> scopes;
+    std::vector<Open> stack;
+    FrameQueries frames[queryFrames];
+    int frameIndex = 0;
+
+    int scopeIndex(const char* name, int depth)
+    {
+        for (size_t i = 0; i < scopes.size(); i++)
+            if (scopes[i].name == name) return (int)i;
+        Scope s;
+        s.name = name;
+        s.depth = depth;
+        scopes.push_back(s);
+        return (int)scopes.size() - 1;
+    }
+
+    GLuint allocQuery(FrameQueries& f)
+    {
+        if (f.used == f.pool.size()) {
+            GLuint q;
+            glGenQueries(1, &q);
+            f.pool.push_back(q);
+        }
+        return f.pool[f.used++];
+    }
+
+    // Read back a frame's timestamps if the GPU is done with them
+    void collect(FrameQueries& f)
+    {
+        if (!f.pending) return;
+        GLint available = 0;
+        glGetQueryObjectiv(f.pool[f.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return;
+
+        std::vector<double> perScope(scopes.size(), -1.0);
+        for (auto& sample : f.samples) {
+            if (!sample.end) continue;
+            GLuint64 t0 = 0, t1 = 0;
+            glGetQueryObjectui64v(sample.begin, GL_QUERY_RESULT, &t0);
+            glGetQueryObjectui64v(sample.end, GL_QUERY_RESULT, &t1);
+            double ms = (double)(t1 - t0) / 1e6;
+            if (onGpuScope) onGpuScope(scopes[sample.scope].name.c_str(), t0, t1);
+            perScope[sample.scope] = std::max(perScope[sample.scope], 0.0) + ms;
+        }
+        for (size_t i = 0; i < scopes.size(); i++) {
+            if (perScope[i] < 0.0) continue;
+            push(scopes[i].gpuMs, scopes[i].gpuPos, scopes[i].gpuCount, (float)perScope[i]);
+        }
+        f.pending = false;
+    }
+
+    static void push(std::vector<float>& hist, int& pos, int& count, float value)
+    {
+        hist[pos] = value;
+        pos = (pos + 1) % historySize;
+        if (count < historySize) count++;
+    }
+
+    static float average(const std::vector<float>& hist, int count)
+    {
+        if (count == 0) return 0.0f;
+        double sum = 0.0;
+        for (int i = 0; i < count; i++) sum += hist[i];
+        return (float)(sum / count);
+    }
+
+    static void statColumns(const std::vector<float>& hist, int count)
+    {
+        ImGui::TableNextColumn(); ImGui::Text("%.3f", average(hist, count));
+        ImGui::TableNextColumn(); ImGui::Text("%.3f", Percentile(hist, count, 0.50f));
+        ImGui::TableNextColumn(); ImGui::Text("%.3f", Percentile(hist, count, 0.95f));
+        ImGui::TableNextColumn(); ImGui::Text("%.3f", Percentile(hist, count, 0.99f));
+    }
+};
+
+// RAII helper: profiles the enclosing block
+class ProfileScope
+{
+public:
+    ProfileScope(Profiler& profiler, const char* name) : profiler(profiler) { profiler.Begin(name); }
+    ~ProfileScope() { profiler.End(); }
+
+private:
+    Profiler& profiler;
+};
+
+#endif
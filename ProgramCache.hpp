@@ -0,0 +1,169 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "DiskCache.hpp"
+#include "Trace.hpp"
+
+// glad is generated for GL 3.3 core: program binaries (GL 4.1 /
+// ARB_get_program_binary) are loaded by hand
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_PROGRAM_SEPARABLE
+#define GL_PROGRAM_SEPARABLE 0x8258
+#endif
+
+// Persistent cache of linked programs. A program is saved with
+// glGetProgramBinary under a key made of its sources and the driver identity
+// (vendor, renderer, version) and restored with glProgramBinary on later
+// runs; a rejected binary (driver update, corrupt file) is simply rebuilt
+// from source and saved again.
+class ProgramCache
+{
+public:
+    bool enabled = true;
+    std::string cacheDir = "cache/programs";
+
+    // Load the entry points and the driver identity; false when binaries are not supported
+    bool Init(GLADloadproc load)
+    {
+        getProgramBinary = (GetProgramBinaryFn)load("glGetProgramBinary");
+        programBinary = (ProgramBinaryFn)load("glProgramBinary");
+        programParameteri = (ProgramParameteriFn)load("glProgramParameteri");
+        GLint formats = 0;
+        if (getProgramBinary && programBinary) glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        supported = formats > 0;
+        if (!supported) {
+            enabled = false;
+            return false;
+        }
+
+        const char* strings[] = { (const char*)glGetString(GL_VENDOR), (const char*)glGetString(GL_RENDERER),
+            (const char*)glGetString(GL_VERSION) };
+        driverHash = fnv1a(std::string());
+        for (const char* s : strings) driverHash = fnv1a(std::string(s ? s : "") + "\n", driverHash);
+        return true;
+    }
+
+    bool Supported() const { return supported; }
+
+    // Call between attaching the shaders and linking, so the driver keeps the binary around
+    void PrepareLink(GLuint program)
+    {
+        if (enabled && programParameteri) programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    // Cache key of a source pair on this driver
+    uint64_t Key(const char* vs, const char* fs) const
+    {
+        // the length of vs keeps "ab" + "c" apart from "a" + "bc"
+        size_t vsLength = strlen(vs);
+        uint64_t key = fnv1a(vs, vsLength, driverHash);
+        key = fnv1a(&vsLength, sizeof(vsLength), key);
+        return fnv1a(fs, strlen(fs), key);
+    }
+
+    // Linked program restored from its binary; 0 on a miss or when the driver rejects it.
+    // Separable programs (single stages of a pipeline) must say so before the binary is loaded.
+    GLuint Load(uint64_t key, bool separable = false)
+    {
+        if (!enabled) return 0;
+        TraceScope trace("Load program binary", "shader");
+        auto start = std::chrono::steady_clock::now();
+        MappedFile file;
+        if (!file.Open(cachePath(key))) return 0;
+
+        CacheHeader header;
+        if (file.Size() < sizeof(header)) return 0;
+        memcpy(&header, file.Data(), sizeof(header));
+        if (memcmp(header.magic, "PBIN", 4) != 0 || header.version != 1 || header.key != key ||
+            file.Size() != sizeof(header) + header.length)
+            return 0;
+
+        GLuint program = glCreateProgram();
+        if (separable && programParameteri) programParameteri(program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+        programBinary(program, header.format, file.Data() + sizeof(header), (GLsizei)header.length);
+        GLint success = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            // e.g. a driver update: fall back to the sources, the entry is rewritten
+            glDeleteProgram(program);
+            rejected++;
+            return 0;
+        }
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        hits++;
+        loadMs += ms;
+        savedMs += header.compileMs - ms;
+        return program;
+    }
+
+    // Save a program linked from source (with PrepareLink) and the time it took
+    void Store(uint64_t key, GLuint program, float compileMs)
+    {
+        if (!enabled) return;
+        misses++;
+        GLint success = GL_FALSE, length = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (!success || length <= 0) return;
+
+        std::vector<unsigned char> binary(length);
+        GLenum format = 0;
+        getProgramBinary(program, length, &length, &format, binary.data());
+        CacheHeader header = { { 'P', 'B', 'I', 'N' }, 1, key, format, (uint32_t)length, compileMs, 0 };
+        if (!writeCacheFile(cachePath(key), &header, sizeof(header), binary.data(), (size_t)length))
+            std::cerr << "Program cache: cannot write " << cachePath(key) << std::endl;
+    }
+
+    int Hits() const { return hits; }
+    int Misses() const { return misses; }
+    int Rejected() const { return rejected; }
+    double LoadMs() const { return loadMs; }
+    // Compile time recorded with the loaded binaries, minus the time it took to load them
+    double SavedMs() const { return savedMs; }
+
+private:
+    typedef void (APIENTRYP GetProgramBinaryFn)(GLuint program, GLsizei bufSize, GLsizei* length,
+        GLenum* binaryFormat, void* binary);
+    typedef void (APIENTRYP ProgramBinaryFn)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+    typedef void (APIENTRYP ProgramParameteriFn)(GLuint program, GLenum pname, GLint value);
+
+    struct CacheHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;
+        uint32_t format;
+        uint32_t length;
+        float compileMs;
+        uint32_t reserved;
+    };
+
+    GetProgramBinaryFn getProgramBinary = nullptr;
+    ProgramBinaryFn programBinary = nullptr;
+    ProgramParameteriFn programParameteri = nullptr;
+    bool supported = false;
+    uint64_t driverHash = 0;
+    int hits = 0, misses = 0, rejected = 0;
+    double loadMs = 0.0, savedMs = 0.0;
+
+    std::string cachePath(uint64_t key) const { return cacheDir + "/" + hashToString(key) + ".bin"; }
+};
+
+#endif
@@ -0,0 +1,222 @@
+#ifndef READBACK_H
+#define READBACK_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "RenderTarget.hpp"
+#include "ThreadPool.hpp"
+#include "Trace.hpp"
+
+// Asynchronous pixel readback through a ring of pixel buffer objects.
+// glReadPixels only queues a copy into a PBO and a fence; the PBO is mapped
+// frames later, once the fence has signaled, and the pixels are handed to a
+// worker thread (encoding, disk writes) so the render loop never waits.
+class AsyncReadback
+{
+public:
+    // Runs on a worker thread with bottom-up RGB rows
+    using Callback = std::function<void(std::vector<unsigned char>& pixels, int width, int height)>;
+    // Same, for frame `index` of a sequence
+    using SequenceCallback = std::function<void(int index, std::vector<unsigned char>& pixels, int width, int height)>;
+
+    AsyncReadback() = default;
+    AsyncReadback(const AsyncReadback&) = delete;
+    AsyncReadback& operator=(const AsyncReadback&) = delete;
+    ~AsyncReadback() { Destroy(); }
+
+    void Init(ThreadPool* pool, int ringSize = 4, int maxQueuedTasks = 16)
+    {
+        Destroy();
+        this->pool = pool;
+        this->maxQueuedTasks = maxQueuedTasks;
+        slots.resize(ringSize);
+        for (auto& s : slots) glGenBuffers(1, &s.pbo);
+        startTime = Clock::now();
+    }
+
+    void Destroy()
+    {
+        for (auto& s : slots) {
+            if (s.fence) glDeleteSync(s.fence);
+            if (s.pbo) glDeleteBuffers(1, &s.pbo);
+        }
+        slots.clear();
+    }
+
+    // Queue a readback of a framebuffer (0 = back buffer of the window)
+    void Capture(GLuint fbo, int width, int height, Callback onReady)
+    {
+        Slot& s = slots[head];
+        if (s.busy) {
+            // ring full: the oldest capture has to be retired first
+            stalls++;
+            retire(s, true);
+        }
+
+        size_t size = (size_t)width * height * 3;
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+        if (fbo == 0) glReadBuffer(GL_BACK);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+        if (s.capacity < size) {
+            glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+            s.capacity = size;
+        }
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        s.width = width;
+        s.height = height;
+        s.callback = std::move(onReady);
+        s.frameIssued = frame;
+        s.timeIssued = Clock::now();
+        s.busy = true;
+        head = (head + 1) % slots.size();
+    }
+
+    // Retire every capture whose fence has signaled; call once per frame
+    void Poll()
+    {
+        frame++;
+        for (size_t i = 0; i < slots.size(); i++) {
+            Slot& s = slots[(head + i) % slots.size()];   // oldest first
+            if (s.busy && !retire(s, false)) break;
+        }
+    }
+
+    // Retire everything and wait for the workers
+    void Flush()
+    {
+        for (size_t i = 0; i < slots.size(); i++) {
+            Slot& s = slots[(head + i) % slots.size()];
+            if (s.busy) retire(s, true);
+        }
+        if (pool) pool->Wait();
+    }
+
+    // Render `count` frames into target and capture every one: render(i) draws frame i
+    // into the bound target, and its pixels go to onPixels(i, ...) on a worker while the
+    // next frames render. Returns the wall time in seconds; the statistics are reset first.
+    double CaptureSequence(RenderTarget& target, int count, const std::function<void(int index)>& render,
+        const SequenceCallback& onPixels)
+    {
+        auto start = Clock::now();
+        ResetStats();
+        for (int i = 0; i < count; i++) {
+            target.Bind();
+            render(i);
+            Capture(target.fbo, target.width, target.height, [&onPixels, i](std::vector<unsigned char>& pixels, int w, int h) {
+                onPixels(i, pixels, w, h);
+            });
+            Poll();
+        }
+        Flush();
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // Statistics
+    int Completed() const { return completed; }
+    int Stalls() const { return stalls; }
+    double AverageLatencyFrames() const { return completed ? latencyFramesSum / completed : 0.0; }
+    double AverageLatencyMs() const { return completed ? latencyMsSum / completed : 0.0; }
+    double ThroughputMBps() const
+    {
+        double sec = std::chrono::duration<double>(Clock::now() - startTime).count();
+        return sec > 0.0 ? bytes / sec / (1024.0 * 1024.0) : 0.0;
+    }
+    double CapturesPerSecond() const
+    {
+        double sec = std::chrono::duration<double>(Clock::now() - startTime).count();
+        return sec > 0.0 ? completed / sec : 0.0;
+    }
+    void ResetStats()
+    {
+        completed = stalls = 0;
+        latencyFramesSum = latencyMsSum = bytes = 0.0;
+        startTime = Clock::now();
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Slot
+    {
+        GLuint pbo = 0;
+        size_t capacity = 0;
+        GLsync fence = nullptr;
+        int width = 0, height = 0;
+        Callback callback;
+        long long frameIssued = 0;
+        Clock::time_point timeIssued;
+        bool busy = false;
+    };
+
+    ThreadPool* pool = nullptr;
+    int maxQueuedTasks = 16;
+    std::vector<Slot> slots;
+    size_t head = 0;
+    long long frame = 0;
+
+    int completed = 0;
+    int stalls = 0;
+    double latencyFramesSum = 0.0;
+    double latencyMsSum = 0.0;
+    double bytes = 0.0;
+    Clock::time_point startTime;
+
+    bool retire(Slot& s, bool wait)
+    {
+        GLenum r = glClientWaitSync(s.fence, 0, 0);
+        if (r == GL_TIMEOUT_EXPIRED) {
+            if (!wait) return false;
+            TraceScope trace("Readback wait", "readback");
+            glClientWaitSync(s.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1000000000));
+        }
+        glDeleteSync(s.fence);
+        s.fence = nullptr;
+
+        size_t size = (size_t)s.width * s.height * 3;
+        auto pixels = std::make_shared<std::vector<unsigned char>>(size);
+        {
+            TraceScope trace("Readback map", "readback");
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+            void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+            if (mapped) {
+                memcpy(pixels->data(), mapped, size);
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+
+        completed++;
+        bytes += (double)size;
+        latencyFramesSum += (double)(frame - s.frameIssued);
+        latencyMsSum += std::chrono::duration<double, std::milli>(Clock::now() - s.timeIssued).count();
+
+        // bound the memory held by queued pixel buffers
+        if (pool) {
+            if (pool->Pending() > maxQueuedTasks) {
+                stalls++;
+                pool->Wait(maxQueuedTasks);
+            }
+            Callback cb = std::move(s.callback);
+            int w = s.width, h = s.height;
+            pool->Submit([cb, pixels, w, h] { cb(*pixels, w, h); });
+        }
+        else {
+            s.callback(*pixels, s.width, s.height);
+        }
+        s.callback = nullptr;
+        s.busy = false;
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef RENDER_TARGET_H
+#define RENDER_TARGET_H
+
+#include <glad/glad.h>
+
+#include <iostream>
+#include <vector>
+
+// Offscreen framebuffer: RGBA8 color texture + 24-bit depth renderbuffer
+class RenderTarget
+{
+public:
+    GLuint fbo = 0;
+    GLuint colorTexture = 0;
+    GLuint depthBuffer = 0;
+    int width = 0;
+    int height = 0;
+
+    RenderTarget() = default;
+    RenderTarget(const RenderTarget&) = delete;
+    RenderTarget& operator=(const RenderTarget&) = delete;
+    ~RenderTarget() { Destroy(); }
+
+    bool Create(int width, int height)
+    {
+        Destroy();
+        this->width = width;
+        this->height = height;
+
+        glGenTextures(1, &colorTexture);
+        glBindTexture(GL_TEXTURE_2D, colorTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glGenRenderbuffers(1, &depthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+        GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "ERROR Framebuffer incomplete: 0x" << std::hex << status << std::dec << std::endl;
+            Destroy();
+            return false;
+        }
+        return true;
+    }
+
+    void Destroy()
+    {
+        if (fbo) glDeleteFramebuffers(1, &fbo);
+        if (colorTexture) glDeleteTextures(1, &colorTexture);
+        if (depthBuffer) glDeleteRenderbuffers(1, &depthBuffer);
+        fbo = colorTexture = depthBuffer = 0;
+    }
+
+    // Bind for rendering and set the viewport to the whole target
+    void Bind() const
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glViewport(0, 0, width, height);
+    }
+
+    // Synchronous readback, bottom-up rows
+    void ReadPixels(std::vector<unsigned char>& pixels, GLenum format = GL_RGB) const
+    {
+        int channels = format == GL_RGBA ? 4 : 3;
+        pixels.resize((size_t)width * height * channels);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, format, GL_UNSIGNED_BYTE, pixels.data());
+    }
+};
+
+#endif
@@ -0,0 +1,270 @@
+#ifndef SHADER_COMPILER_H
+#define SHADER_COMPILER_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ProgramCache.hpp"
+#include "Trace.hpp"
+
+// KHR_parallel_shader_compile (also exposed as ARB_parallel_shader_compile);
+// not in the GL 3.3 core glad loader
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+// ARB_separate_shader_objects (GL 4.1), same story
+#ifndef GL_VERTEX_SHADER_BIT
+#define GL_VERTEX_SHADER_BIT 0x00000001
+#endif
+#ifndef GL_FRAGMENT_SHADER_BIT
+#define GL_FRAGMENT_SHADER_BIT 0x00000002
+#endif
+
+// Compilation scheduler. Submit() issues the compiles and the link and returns
+// at once; with KHR_parallel_shader_compile the driver builds the program on
+// its own threads and Ready() polls GL_COMPLETION_STATUS_KHR, so nothing
+// blocks until Finish() is called on a program that is ready. Without the
+// extension Ready() cannot tell, and Finish() may wait for the driver.
+// Programs go through the binary cache when one is given.
+// With ARB_separate_shader_objects it also builds single-stage separable
+// programs, linked against shared library shader objects that are compiled
+// only once, and combines them into program pipelines.
+class ShaderCompiler
+{
+public:
+    void Init(GLADloadproc load, ProgramCache* cache)
+    {
+        this->cache = cache;
+        typedef void (APIENTRYP MaxShaderCompilerThreadsFn)(GLuint count);
+        MaxShaderCompilerThreadsFn maxThreads = nullptr;
+        if (hasExtension("GL_KHR_parallel_shader_compile"))
+            maxThreads = (MaxShaderCompilerThreadsFn)load("glMaxShaderCompilerThreadsKHR");
+        else if (hasExtension("GL_ARB_parallel_shader_compile"))
+            maxThreads = (MaxShaderCompilerThreadsFn)load("glMaxShaderCompilerThreadsARB");
+        parallel = maxThreads != nullptr;
+        if (parallel) maxThreads(0xFFFFFFFFu);     // as many threads as the driver wants
+
+        if (hasExtension("GL_ARB_separate_shader_objects")) {
+            programParameteri = (ProgramParameteriFn)load("glProgramParameteri");
+            genProgramPipelines = (GenProgramPipelinesFn)load("glGenProgramPipelines");
+            deleteProgramPipelines = (DeleteProgramPipelinesFn)load("glDeleteProgramPipelines");
+            bindProgramPipeline = (BindProgramPipelineFn)load("glBindProgramPipeline");
+            useProgramStages = (UseProgramStagesFn)load("glUseProgramStages");
+        }
+        separable = programParameteri && genProgramPipelines && deleteProgramPipelines &&
+            bindProgramPipeline && useProgramStages;
+    }
+
+    bool Parallel() const { return parallel; }
+    bool Separable() const { return separable; }
+
+    // Start building a program; the name is valid at once, usable once Finish() succeeded
+    GLuint Submit(const char* vs, const char* fs)
+    {
+        TraceScope trace("Submit program", "shader");
+        uint64_t key = cache ? cache->Key(vs, fs) : 0;
+        if (cache) {
+            GLuint program = cache->Load(key);
+            if (program) return program;
+        }
+
+        Job job;
+        job.key = key;
+        job.start = std::chrono::steady_clock::now();
+        job.shaders = { submitShader(GL_VERTEX_SHADER, vs), submitShader(GL_FRAGMENT_SHADER, fs) };
+        return link(job, false);
+    }
+
+    // Compile a shader object shared by several separable programs (no main()); waits for it
+    GLuint CompileLibrary(GLenum type, const std::string& src)
+    {
+        TraceScope trace("Compile shader library", "shader");
+        GLuint shader = submitShader(type, src.c_str());
+        checkShader(shader);
+        libraryHashes[shader] = fnv1a(src);
+        return shader;
+    }
+
+    void DeleteLibrary(GLuint shader)
+    {
+        libraryHashes.erase(shader);
+        glDeleteShader(shader);
+    }
+
+    // Start building a separable program of a single stage, linked with library shader objects
+    GLuint SubmitStage(GLenum type, const char* src, const std::vector<GLuint>& libraries)
+    {
+        TraceScope trace("Submit program stage", "shader");
+        std::string libraryKey = "separable " + std::to_string(type);
+        for (GLuint lib : libraries) libraryKey += " " + hashToString(libraryHashes[lib]);
+        uint64_t key = cache ? cache->Key(libraryKey.c_str(), src) : 0;
+        if (cache) {
+            GLuint program = cache->Load(key, true);
+            if (program) return program;
+        }
+
+        Job job;
+        job.key = key;
+        job.start = std::chrono::steady_clock::now();
+        job.shaders = { submitShader(type, src) };
+        job.libraries = libraries;
+        return link(job, true);
+    }
+
+    // Blocking build of a single stage: SubmitStage() + Finish()
+    GLuint BuildStage(GLenum type, const char* src, const std::vector<GLuint>& libraries)
+    {
+        GLuint program = SubmitStage(type, src, libraries);
+        Finish(program);
+        return program;
+    }
+
+    GLuint CreatePipeline(GLuint vertexProgram, GLuint fragmentProgram)
+    {
+        GLuint pipeline = 0;
+        genProgramPipelines(1, &pipeline);
+        useProgramStages(pipeline, GL_VERTEX_SHADER_BIT, vertexProgram);
+        useProgramStages(pipeline, GL_FRAGMENT_SHADER_BIT, fragmentProgram);
+        return pipeline;
+    }
+
+    // A bound program overrides the pipeline, so the program binding is cleared first
+    void BindPipeline(GLuint pipeline)
+    {
+        glUseProgram(0);
+        bindProgramPipeline(pipeline);
+    }
+
+    void DeletePipeline(GLuint pipeline)
+    {
+        if (pipeline) deleteProgramPipelines(1, &pipeline);
+    }
+
+    // True when Finish() will not wait (always true without the extension)
+    bool Ready(GLuint program) const
+    {
+        if (!parallel || !jobs.count(program)) return true;
+        GLint done = GL_FALSE;
+        glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &done);
+        return done == GL_TRUE;
+    }
+
+    // Check the results (logging errors) and save the binary; false if the build failed
+    bool Finish(GLuint program)
+    {
+        auto it = jobs.find(program);
+        if (it == jobs.end()) return true;
+        TraceScope trace("Finish program", "shader");
+        Job job = it->second;
+        jobs.erase(it);
+
+        bool ok = true;
+        for (GLuint shader : job.shaders) ok &= checkShader(shader);
+        GLint success;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            char infoLog[512];
+            glGetProgramInfoLog(program, 512, nullptr, infoLog);
+            std::cerr << "ERROR Program linking: " << infoLog << std::endl;
+            ok = false;
+        }
+        for (GLuint shader : job.shaders) {
+            glDetachShader(program, shader);
+            glDeleteShader(shader);
+        }
+        for (GLuint shader : job.libraries) glDetachShader(program, shader);
+
+        if (ok && cache) {
+            float ms = (float)std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - job.start).count();
+            cache->Store(job.key, program, ms);
+        }
+        return ok;
+    }
+
+    // Blocking build: Submit() + Finish()
+    GLuint Build(const char* vs, const char* fs)
+    {
+        GLuint program = Submit(vs, fs);
+        Finish(program);
+        return program;
+    }
+
+    int Pending() const { return (int)jobs.size(); }
+
+private:
+    typedef void (APIENTRYP ProgramParameteriFn)(GLuint program, GLenum pname, GLint value);
+    typedef void (APIENTRYP GenProgramPipelinesFn)(GLsizei n, GLuint* pipelines);
+    typedef void (APIENTRYP DeleteProgramPipelinesFn)(GLsizei n, const GLuint* pipelines);
+    typedef void (APIENTRYP BindProgramPipelineFn)(GLuint pipeline);
+    typedef void (APIENTRYP UseProgramStagesFn)(GLuint pipeline, GLbitfield stages, GLuint program);
+
+    struct Job
+    {
+        std::vector<GLuint> shaders;    // compiled for this program, deleted once linked
+        std::vector<GLuint> libraries;  // shared, only detached
+        uint64_t key = 0;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    ProgramCache* cache = nullptr;
+    bool parallel = false;
+    bool separable = false;
+    ProgramParameteriFn programParameteri = nullptr;
+    GenProgramPipelinesFn genProgramPipelines = nullptr;
+    DeleteProgramPipelinesFn deleteProgramPipelines = nullptr;
+    BindProgramPipelineFn bindProgramPipeline = nullptr;
+    UseProgramStagesFn useProgramStages = nullptr;
+    std::map<GLuint, Job> jobs;                 // by program name
+    std::map<GLuint, uint64_t> libraryHashes;   // source hash of every library shader
+
+    GLuint link(const Job& job, bool separableProgram)
+    {
+        GLuint program = glCreateProgram();
+        if (separableProgram) programParameteri(program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+        for (GLuint shader : job.shaders) glAttachShader(program, shader);
+        for (GLuint shader : job.libraries) glAttachShader(program, shader);
+        if (cache) cache->PrepareLink(program);
+        glLinkProgram(program);
+        jobs[program] = job;
+        return program;
+    }
+
+    static bool hasExtension(const char* name)
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++) {
+            const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, i);
+            if (ext && strcmp(ext, name) == 0) return true;
+        }
+        return false;
+    }
+
+    static GLuint submitShader(GLenum type, const char* src)
+    {
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 1, &src, nullptr);
+        glCompileShader(shader);
+        return shader;
+    }
+
+    static bool checkShader(GLuint shader)
+    {
+        GLint success;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            char infoLog[512];
+            glGetShaderInfoLog(shader, 512, nullptr, infoLog);
+            std::cerr << "ERROR Shader compilation: " << infoLog << std::endl;
+        }
+        return success == GL_TRUE;
+    }
+};
+
+#endif
@@ -0,0 +1,208 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <string>
+
+#include "ShaderCompiler.hpp"
+
+// Permutations of one vertex/fragment source pair, specialized per material
+// pattern (MaterialTable.hpp) with a MATERIAL_PATTERN define, so the shaders
+// carry no per-fragment pattern branches; the parameters of a material come
+// from its record in the material table. Variants are built on first use (or
+// all at once with SubmitAll) and kept for the whole run.
+// In async mode Get() never waits for the compiler: until a variant is ready
+// it returns the fallback pattern's variant (flat color, cheap to build),
+// and Poll() picks up finished variants once per frame. That needs
+// KHR_parallel_shader_compile to tell when a variant is done; without it
+// SubmitAll() builds every variant at once, as a loading step before the
+// first frame, instead of blocking some later frame.
+// In pipeline mode (separate shader objects) the vertex stage and the fragment
+// library are built once; a variant only compiles its small material stage,
+// linked against the library, and Get() returns a program pipeline.
+class ShaderVariants
+{
+public:
+    // Called once on every new program (uniform block bindings, samplers)
+    using Setup = std::function<void(GLuint program)>;
+
+    bool async = false;
+    int fallbackPattern = 0;
+
+    ShaderVariants() = default;
+    ShaderVariants(const ShaderVariants&) = delete;
+    ShaderVariants& operator=(const ShaderVariants&) = delete;
+    ~ShaderVariants() { Destroy(); }
+
+    void Init(const std::string& vsSource, const std::string& fsSource, ShaderCompiler* compiler, Setup setup = nullptr)
+    {
+        Destroy();
+        vs = vsSource;
+        fs = fsSource;
+        this->compiler = compiler;
+        this->setup = setup;
+    }
+
+    // Pipeline mode: fsLibrarySource holds the shared fragment code, fsStageSource
+    // the material stage (materialColor and main) that is specialized per pattern.
+    // False when separate shader objects are not supported.
+    bool InitPipelines(const std::string& vsSource, const std::string& fsLibrarySource,
+        const std::string& fsStageSource, ShaderCompiler* compiler, Setup setup = nullptr)
+    {
+        Destroy();
+        if (!compiler->Separable()) return false;
+        this->compiler = compiler;
+        this->setup = setup;
+        pipelines = true;
+        fs = Specialize(fsStageSource, separableExtension);
+
+        TraceScope trace("Build shared stages", "shader");
+        std::string vsSeparable = Specialize(vsSource, separableExtension);
+        vertexProgram = compiler->BuildStage(GL_VERTEX_SHADER, vsSeparable.c_str(), {});
+        if (setup) setup(vertexProgram);
+        library = compiler->CompileLibrary(GL_FRAGMENT_SHADER, Specialize(fsLibrarySource, separableExtension));
+        return true;
+    }
+
+    void Destroy()
+    {
+        for (auto& v : variants) {
+            if (!v.second.ready) compiler->Finish(v.second.program);
+            if (v.second.pipeline) compiler->DeletePipeline(v.second.pipeline);
+            glDeleteProgram(v.second.program);
+        }
+        variants.clear();
+        if (vertexProgram) glDeleteProgram(vertexProgram);
+        if (library) compiler->DeleteLibrary(library);
+        vertexProgram = library = 0;
+        pipelines = false;
+    }
+
+    bool Pipelines() const { return pipelines; }
+
+    // Bind what Get() returned: a program, or a pipeline in pipeline mode (0 unbinds)
+    void Use(GLuint handle)
+    {
+        if (pipelines) compiler->BindPipeline(handle);
+        else glUseProgram(handle);
+    }
+
+    // Program that holds the vertex stage (and the "model" uniform) of a handle
+    GLuint VertexProgram(GLuint handle) const { return pipelines ? vertexProgram : handle; }
+
+    // Program that holds the fragment stage (and the material uniforms) of a handle
+    GLuint FragmentProgram(GLuint handle) const
+    {
+        if (!pipelines) return handle;
+        for (auto& v : variants)
+            if (v.second.pipeline == handle) return v.second.program;
+        return 0;
+    }
+
+    // Program (or pipeline) for material pattern `pattern`
+    GLuint Get(int pattern)
+    {
+        Variant& v = submit(pattern);
+        if (v.ready) return handle(v);
+        if (!async || !compiler->Parallel()) return finish(v);
+        return pattern == fallbackPattern ? finish(v) : Wait(fallbackPattern);
+    }
+
+    // Like Get(), but always the requested variant, waiting for it if needed
+    GLuint Wait(int pattern)
+    {
+        Variant& v = submit(pattern);
+        return v.ready ? handle(v) : finish(v);
+    }
+
+    // Start building every pattern up front; without parallel compilation
+    // they are finished right away
+    void SubmitAll(int patternCount)
+    {
+        for (int pattern = 0; pattern < patternCount; pattern++) submit(pattern);
+        if (!compiler->Parallel())
+            for (auto& v : variants)
+                if (!v.second.ready) finish(v.second);
+    }
+
+    // Pick up the variants the compiler has finished (parallel compilation only;
+    // otherwise nothing is left pending to pick up)
+    void Poll()
+    {
+        if (!compiler->Parallel()) return;
+        for (auto& v : variants)
+            if (!v.second.ready && compiler->Ready(v.second.program)) finish(v.second);
+    }
+
+    int Count() const { return (int)variants.size(); }
+    // Main thread time spent submitting and finishing variants
+    double BuildMs() const { return buildMs; }
+    int PendingCount() const
+    {
+        int pending = 0;
+        for (auto& v : variants) pending += v.second.ready ? 0 : 1;
+        return pending;
+    }
+
+    // Insert defines right after the #version line
+    static std::string Specialize(const std::string& source, const std::string& defines)
+    {
+        size_t version = source.find("#version");
+        size_t line = version == std::string::npos ? 0 : source.find('\n', version);
+        if (line == std::string::npos) return source + "\n" + defines;
+        if (version != std::string::npos) line++;
+        return source.substr(0, line) + defines + source.substr(line);
+    }
+
+private:
+    struct Variant
+    {
+        GLuint program = 0;
+        GLuint pipeline = 0;    // pipeline mode: shared vertex stage + this fragment stage
+        bool ready = false;
+    };
+
+    static constexpr const char* separableExtension = "#extension GL_ARB_separate_shader_objects : enable\n";
+
+    std::string vs, fs;
+    ShaderCompiler* compiler = nullptr;
+    Setup setup;
+    std::map<int, Variant> variants;
+    bool pipelines = false;
+    GLuint vertexProgram = 0;
+    GLuint library = 0;
+    double buildMs = 0.0;
+
+    GLuint handle(const Variant& v) const { return pipelines ? v.pipeline : v.program; }
+
+    Variant& submit(int pattern)
+    {
+        auto it = variants.find(pattern);
+        if (it != variants.end()) return it->second;
+
+        std::string fsVariant = Specialize(fs, "#define MATERIAL_PATTERN " + std::to_string(pattern) + "\n");
+        auto start = std::chrono::steady_clock::now();
+        Variant& v = variants[pattern];
+        v.program = pipelines ? compiler->SubmitStage(GL_FRAGMENT_SHADER, fsVariant.c_str(), { library })
+            : compiler->Submit(vs.c_str(), fsVariant.c_str());
+        buildMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return v;
+    }
+
+    GLuint finish(Variant& v)
+    {
+        auto start = std::chrono::steady_clock::now();
+        compiler->Finish(v.program);
+        if (setup) setup(v.program);
+        if (pipelines) v.pipeline = compiler->CreatePipeline(vertexProgram, v.program);
+        v.ready = true;
+        buildMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return handle(v);
+    }
+};
+
+#endif
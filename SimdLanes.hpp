@@ -0,0 +1,256 @@
+#ifndef SIMD_LANES_H
+#define SIMD_LANES_H
+
+#include <cmath>
+
+// Lane types for writing a kernel once and running it 1, 4 or 8 pixels wide:
+//   float   scalar reference
+//   Float4  SSE4.1
+//   Float8  AVX2
+// Every operation rounds like its scalar counterpart and sin() uses the same
+// double precision algorithm in all widths, so the wide kernels reproduce the
+// scalar results bit for bit, as long as the compiler does not fuse multiply-adds
+// in the scalar code (MSVC's default /fp:precise; -ffp-contract=off for GCC/Clang).
+//
+// Both wide types are compiled for x86 and picked at runtime, without target
+// flags for the whole file: MSVC accepts every intrinsic anyway, and for GCC and
+// Clang the wide functions carry a target attribute. A kernel entry point
+// (SIMD_KERNEL_SSE41 / SIMD_KERNEL_AVX2) is compiled for its instruction set with
+// everything it calls inlined into it (flatten), so the templates in between need
+// no attribute and no wide value crosses a call of another target. Builds that do
+// not inline (-O0) only get the wide types their target flags enable.
+#if defined(_MSC_VER)
+#define SIMD_HAVE_SSE41 1
+#define SIMD_HAVE_AVX2 1
+#include <intrin.h>
+#include <immintrin.h>
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(__NO_INLINE__)
+#define SIMD_HAVE_SSE41 1
+#define SIMD_HAVE_AVX2 1
+#define SIMD_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#define SIMD_KERNEL_SSE41 __attribute__((target("sse4.1"), flatten))
+#define SIMD_KERNEL_AVX2 __attribute__((target("avx2"), flatten))
+#include <immintrin.h>
+#else
+#if defined(__SSE4_1__)
+#define SIMD_HAVE_SSE41 1
+#include <smmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define SIMD_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+#ifndef SIMD_TARGET_SSE41
+#define SIMD_TARGET_SSE41
+#define SIMD_TARGET_AVX2
+#define SIMD_KERNEL_SSE41
+#define SIMD_KERNEL_AVX2
+#endif
+
+namespace simd {
+
+enum class Isa { Scalar, SSE41, AVX2 };
+
+inline const char* IsaName(Isa isa)
+{
+    return isa == Isa::AVX2 ? "AVX2" : isa == Isa::SSE41 ? "SSE4.1" : "scalar";
+}
+
+// Widest instruction set that is both compiled in and supported by this CPU
+inline Isa BestIsa()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool sse41 = (info[2] >> 19) & 1;
+    bool osxsave = (info[2] >> 27) & 1;
+    bool avx2 = false;
+    if (maxLeaf >= 7 && osxsave && (_xgetbv(0) & 6) == 6) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] >> 5) & 1;
+    }
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    bool sse41 = __builtin_cpu_supports("sse4.1");
+    bool avx2 = __builtin_cpu_supports("avx2");
+#else
+    bool sse41 = false, avx2 = false;
+#endif
+#ifdef SIMD_HAVE_AVX2
+    if (avx2) return Isa::AVX2;
+#endif
+#ifdef SIMD_HAVE_SSE41
+    if (sse41) return Isa::SSE41;
+#endif
+    (void)sse41; (void)avx2;
+    return Isa::Scalar;
+}
+
+// ---------------------------------------------------
+// Scalar double helpers of the sin kernel (the wide ones are found through ADL)
+inline double dround(double x) { return std::nearbyint(x); }
+inline double dfloor(double x) { return std::floor(x); }
+inline double dselectEq(double a, double b, double t, double f) { return a == b ? t : f; }
+inline double dselectGe(double a, double b, double t, double f) { return a >= b ? t : f; }
+
+// ---------------------------------------------------
+// sin in double precision: quadrant reduction by pi/2 and the fdlibm kernels.
+// The argument of the hash functions reaches ~1e7, far beyond what a float
+// reduction handles; rounded back to float this matches sinf.
+template<class D>
+inline D sinKernel(D x)
+{
+    const double invPio2 = 6.36619772367581382433e-01;
+    const double pio2Hi = 1.57079632673412561417e+00;
+    const double pio2Lo = 6.07710050650619224932e-11;
+
+    D q = dround(x * D(invPio2));
+    D r = (x - q * D(pio2Hi)) - q * D(pio2Lo);
+    D z = r * r;
+    D s = r + r * z * (D(-1.66666666666666324348e-01) + z * (D(8.33333333332248946124e-03)
+        + z * (D(-1.98412698298579493134e-04) + z * (D(2.75573137070700676789e-06)
+        + z * (D(-2.50507602534068634195e-08) + z * D(1.58969099521155010221e-10))))));
+    D c = D(1.0) - D(0.5) * z + z * z * (D(4.16666666666666019037e-02) + z * (D(-1.38888888888741095749e-03)
+        + z * (D(2.48015872894767294178e-05) + z * (D(-2.75573143513906633035e-07)
+        + z * (D(2.08757232129817482790e-09) + z * D(-1.13596475577881948265e-11))))));
+
+    // quadrant 0..3: odd quadrants use cos, quadrants 2 and 3 flip the sign
+    D quadrant = q - dfloor(q * D(0.25)) * D(4.0);
+    D odd = quadrant - dfloor(quadrant * D(0.5)) * D(2.0);
+    D v = dselectEq(odd, D(1.0), c, s);
+    return dselectGe(quadrant, D(2.0), D(0.0) - v, v);
+}
+
+// ---------------------------------------------------
+// Scalar float lanes
+inline float vfloor(float x) { return std::floor(x); }
+inline float vabs(float x) { return std::fabs(x); }
+inline float vmin(float a, float b) { return a < b ? a : b; }
+inline float vmax(float a, float b) { return a > b ? a : b; }
+inline float vsin(float x) { return (float)sinKernel((double)x); }
+template<class F> inline F vload(const float* p);
+template<> inline float vload<float>(const float* p) { return *p; }
+inline void vstore(float* p, float x) { *p = x; }
+
+// ---------------------------------------------------
+// SSE4.1
+#ifdef SIMD_HAVE_SSE41
+struct Double2
+{
+    __m128d v;
+    Double2() = default;
+    SIMD_TARGET_SSE41 Double2(__m128d v) : v(v) {}
+    SIMD_TARGET_SSE41 Double2(double x) : v(_mm_set1_pd(x)) {}
+};
+SIMD_TARGET_SSE41 inline Double2 operator+(Double2 a, Double2 b) { return _mm_add_pd(a.v, b.v); }
+SIMD_TARGET_SSE41 inline Double2 operator-(Double2 a, Double2 b) { return _mm_sub_pd(a.v, b.v); }
+SIMD_TARGET_SSE41 inline Double2 operator*(Double2 a, Double2 b) { return _mm_mul_pd(a.v, b.v); }
+SIMD_TARGET_SSE41 inline Double2 dround(Double2 x) { return _mm_round_pd(x.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+SIMD_TARGET_SSE41 inline Double2 dfloor(Double2 x) { return _mm_floor_pd(x.v); }
+SIMD_TARGET_SSE41 inline Double2 dselectEq(Double2 a, Double2 b, Double2 t, Double2 f) { return _mm_blendv_pd(f.v, t.v, _mm_cmpeq_pd(a.v, b.v)); }
+SIMD_TARGET_SSE41 inline Double2 dselectGe(Double2 a, Double2 b, Double2 t, Double2 f) { return _mm_blendv_pd(f.v, t.v, _mm_cmpge_pd(a.v, b.v)); }
+
+struct Float4
+{
+    static const int lanes = 4;
+    __m128 v;
+    Float4() = default;
+    SIMD_TARGET_SSE41 Float4(__m128 v) : v(v) {}
+    SIMD_TARGET_SSE41 Float4(float x) : v(_mm_set1_ps(x)) {}
+};
+SIMD_TARGET_SSE41 inline Float4 operator+(Float4 a, Float4 b) { return _mm_add_ps(a.v, b.v); }
+SIMD_TARGET_SSE41 inline Float4 operator-(Float4 a, Float4 b) { return _mm_sub_ps(a.v, b.v); }
+SIMD_TARGET_SSE41 inline Float4 operator*(Float4 a, Float4 b) { return _mm_mul_ps(a.v, b.v); }
+SIMD_TARGET_SSE41 inline Float4 operator/(Float4 a, Float4 b) { return _mm_div_ps(a.v, b.v); }
+SIMD_TARGET_SSE41 inline Float4 operator+(Float4 a, float b) { return a + Float4(b); }
+SIMD_TARGET_SSE41 inline Float4 operator-(Float4 a, float b) { return a - Float4(b); }
+SIMD_TARGET_SSE41 inline Float4 operator*(Float4 a, float b) { return a * Float4(b); }
+SIMD_TARGET_SSE41 inline Float4 operator/(Float4 a, float b) { return a / Float4(b); }
+SIMD_TARGET_SSE41 inline Float4 operator+(float a, Float4 b) { return Float4(a) + b; }
+SIMD_TARGET_SSE41 inline Float4 operator-(float a, Float4 b) { return Float4(a) - b; }
+SIMD_TARGET_SSE41 inline Float4 operator*(float a, Float4 b) { return Float4(a) * b; }
+SIMD_TARGET_SSE41 inline Float4 vfloor(Float4 x) { return _mm_floor_ps(x.v); }
+SIMD_TARGET_SSE41 inline Float4 vabs(Float4 x) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), x.v); }
+SIMD_TARGET_SSE41 inline Float4 vmin(Float4 a, Float4 b) { return _mm_min_ps(a.v, b.v); }
+SIMD_TARGET_SSE41 inline Float4 vmax(Float4 a, Float4 b) { return _mm_max_ps(a.v, b.v); }
+template<> SIMD_TARGET_SSE41 inline Float4 vload<Float4>(const float* p) { return _mm_loadu_ps(p); }
+SIMD_TARGET_SSE41 inline void vstore(float* p, Float4 x) { _mm_storeu_ps(p, x.v); }
+SIMD_TARGET_SSE41 inline Float4 vsin(Float4 x)
+{
+    __m128d lo = sinKernel(Double2(_mm_cvtps_pd(x.v))).v;
+    __m128d hi = sinKernel(Double2(_mm_cvtps_pd(_mm_movehl_ps(x.v, x.v)))).v;
+    return _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi));
+}
+#endif
+
+// ---------------------------------------------------
+// AVX2
+#ifdef SIMD_HAVE_AVX2
+struct Double4
+{
+    __m256d v;
+    Double4() = default;
+    SIMD_TARGET_AVX2 Double4(__m256d v) : v(v) {}
+    SIMD_TARGET_AVX2 Double4(double x) : v(_mm256_set1_pd(x)) {}
+};
+SIMD_TARGET_AVX2 inline Double4 operator+(Double4 a, Double4 b) { return _mm256_add_pd(a.v, b.v); }
+SIMD_TARGET_AVX2 inline Double4 operator-(Double4 a, Double4 b) { return _mm256_sub_pd(a.v, b.v); }
+SIMD_TARGET_AVX2 inline Double4 operator*(Double4 a, Double4 b) { return _mm256_mul_pd(a.v, b.v); }
+SIMD_TARGET_AVX2 inline Double4 dround(Double4 x) { return _mm256_round_pd(x.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+SIMD_TARGET_AVX2 inline Double4 dfloor(Double4 x) { return _mm256_floor_pd(x.v); }
+SIMD_TARGET_AVX2 inline Double4 dselectEq(Double4 a, Double4 b, Double4 t, Double4 f) { return _mm256_blendv_pd(f.v, t.v, _mm256_cmp_pd(a.v, b.v, _CMP_EQ_OQ)); }
+SIMD_TARGET_AVX2 inline Double4 dselectGe(Double4 a, Double4 b, Double4 t, Double4 f) { return _mm256_blendv_pd(f.v, t.v, _mm256_cmp_pd(a.v, b.v, _CMP_GE_OQ)); }
+
+struct Float8
+{
+    static const int lanes = 8;
+    __m256 v;
+    Float8() = default;
+    SIMD_TARGET_AVX2 Float8(__m256 v) : v(v) {}
+    SIMD_TARGET_AVX2 Float8(float x) : v(_mm256_set1_ps(x)) {}
+};
+SIMD_TARGET_AVX2 inline Float8 operator+(Float8 a, Float8 b) { return _mm256_add_ps(a.v, b.v); }
+SIMD_TARGET_AVX2 inline Float8 operator-(Float8 a, Float8 b) { return _mm256_sub_ps(a.v, b.v); }
+SIMD_TARGET_AVX2 inline Float8 operator*(Float8 a, Float8 b) { return _mm256_mul_ps(a.v, b.v); }
+SIMD_TARGET_AVX2 inline Float8 operator/(Float8 a, Float8 b) { return _mm256_div_ps(a.v, b.v); }
+SIMD_TARGET_AVX2 inline Float8 operator+(Float8 a, float b) { return a + Float8(b); }
+SIMD_TARGET_AVX2 inline Float8 operator-(Float8 a, float b) { return a - Float8(b); }
+SIMD_TARGET_AVX2 inline Float8 operator*(Float8 a, float b) { return a * Float8(b); }
+SIMD_TARGET_AVX2 inline Float8 operator/(Float8 a, float b) { return a / Float8(b); }
+SIMD_TARGET_AVX2 inline Float8 operator+(float a, Float8 b) { return Float8(a) + b; }
+SIMD_TARGET_AVX2 inline Float8 operator-(float a, Float8 b) { return Float8(a) - b; }
+SIMD_TARGET_AVX2 inline Float8 operator*(float a, Float8 b) { return Float8(a) * b; }
+SIMD_TARGET_AVX2 inline Float8 vfloor(Float8 x) { return _mm256_floor_ps(x.v); }
+SIMD_TARGET_AVX2 inline Float8 vabs(Float8 x) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x.v); }
+SIMD_TARGET_AVX2 inline Float8 vmin(Float8 a, Float8 b) { return _mm256_min_ps(a.v, b.v); }
+SIMD_TARGET_AVX2 inline Float8 vmax(Float8 a, Float8 b) { return _mm256_max_ps(a.v, b.v); }
+template<> SIMD_TARGET_AVX2 inline Float8 vload<Float8>(const float* p) { return _mm256_loadu_ps(p); }
+SIMD_TARGET_AVX2 inline void vstore(float* p, Float8 x) { _mm256_storeu_ps(p, x.v); }
+SIMD_TARGET_AVX2 inline Float8 vsin(Float8 x)
+{
+    __m256d lo = sinKernel(Double4(_mm256_cvtps_pd(_mm256_castps256_ps128(x.v)))).v;
+    __m256d hi = sinKernel(Double4(_mm256_cvtps_pd(_mm256_extractf128_ps(x.v, 1)))).v;
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(lo)), _mm256_cvtpd_ps(hi), 1);
+}
+#endif
+
+// ---------------------------------------------------
+// GLSL helpers on any lane type
+template<class F> inline F vfract(F x) { return x - vfloor(x); }
+template<class F> inline F vclamp(F x, F lo, F hi) { return vmin(vmax(x, lo), hi); }
+template<class F> inline F vmix(F a, F b, F t) { return a * (F(1.0f) - t) + b * t; }
+template<class F> inline F vsmoothstep(float e0, float e1, F x)
+{
+    F t = vclamp(F((x - F(e0)) / F(e1 - e0)), F(0.0f), F(1.0f));
+    return t * t * (F(3.0f) - F(2.0f) * t);
+}
+
+template<class F> struct LaneCount { static const int value = F::lanes; };
+template<> struct LaneCount<float> { static const int value = 1; };
+
+}
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Trace.hpp"
+
+// Fixed-size pool of worker threads for CPU work (image encoding, disk writes, ...)
+class ThreadPool
+{
+public:
+    explicit ThreadPool(int threads = 0)
+    {
+        if (threads <= 0) threads = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+        for (int i = 0; i < threads; i++)
+            workers.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& t : workers) t.join();
+    }
+
+    int Size() const { return (int)workers.size(); }
+
+    void Submit(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+            pending++;
+        }
+        wake.notify_one();
+    }
+
+    // Tasks queued or running
+    int Pending()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return pending;
+    }
+
+    // Block until at most maxPending tasks are left (0 = until everything is done)
+    void Wait(int maxPending = 0)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&] { return pending <= maxPending; });
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    int pending = 0;
+    bool stopping = false;
+
+    void workerLoop(int index)
+    {
+        Tracer::Get().SetThreadName(("Worker " + std::to_string(index)).c_str());
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty()) return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending--;
+            }
+            done.notify_all();
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,238 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Timeline capture in Chrome Trace Event format (chrome://tracing, Perfetto).
+// Every thread writes into its own ring buffer: the writer only touches its own
+// slots and publishes them with an atomic head, so recording never takes a lock.
+// The head carries the capture generation it belongs to: Start() only bumps the
+// generation, and each writer restarts its own ring on its next event.
+// A thread gets its ring when it first records during a capture, so threads that
+// never do (or runs without tracing) cost no memory.
+class Tracer
+{
+public:
+    using Clock = std::chrono::high_resolution_clock;
+
+    static const uint32_t ringCapacity = 1 << 16;   // events per thread
+    static const uint32_t gpuTid = 1000;            // pseudo thread for GPU events
+
+    struct Event
+    {
+        char name[48];
+        const char* category;
+        double startUs;
+        double durationUs;
+        uint32_t tid;
+    };
+
+    static Tracer& Get()
+    {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    bool IsRecording() const { return recording.load(std::memory_order_relaxed); }
+
+    // Start recording; frames <= 0 records until Stop() or Finish()
+    void Start(int frames, const std::string& path)
+    {
+        framesLeft = frames;
+        outputPath = path;
+        generation.fetch_add(1, std::memory_order_relaxed);
+        recording.store(true, std::memory_order_release);
+    }
+
+    // Call once per frame; stops and writes the file after the requested number of frames
+    void FrameDone()
+    {
+        if (!IsRecording() || framesLeft <= 0) return;
+        if (--framesLeft == 0) {
+            Stop();
+            Write(outputPath);
+        }
+    }
+
+    void Stop()
+    {
+        recording.store(false, std::memory_order_release);
+    }
+
+    // Stop a capture that is still running and write it; call once at exit, after
+    // every thread that records has stopped
+    void Finish()
+    {
+        if (!IsRecording()) return;
+        Stop();
+        Write(outputPath);
+    }
+
+    double ToUs(Clock::time_point t) const
+    {
+        return std::chrono::duration<double, std::micro>(t - epoch).count();
+    }
+
+    double NowUs() const { return ToUs(Clock::now()); }
+
+    // Record a complete event on the calling thread
+    void Record(const char* name, const char* category, double startUs, double durationUs)
+    {
+        if (!IsRecording()) return;
+        ThreadBuffer* b = threadBuffer();
+        push(*b, name, category, startUs, durationUs, b->tid);
+    }
+
+    // GPU events go to their own row; timestamps are GL_TIMESTAMP nanoseconds
+    void RecordGpu(const char* name, uint64_t gpuStartNs, uint64_t gpuEndNs)
+    {
+        if (!IsRecording() || !gpuCalibrated) return;
+        double startUs = gpuStartNs / 1000.0 - gpuOffsetUs;
+        push(*threadBuffer(), name, "gpu", startUs, (gpuEndNs - gpuStartNs) / 1000.0, gpuTid);
+    }
+
+    // Relate the GPU timestamp clock to ours (call with a GL_TIMESTAMP read right now)
+    void CalibrateGpu(uint64_t gpuNowNs)
+    {
+        gpuOffsetUs = gpuNowNs / 1000.0 - NowUs();
+        gpuCalibrated = true;
+    }
+
+    // Name of the calling thread in the trace; kept apart from the rings
+    void SetThreadName(const char* name)
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        threadNames[std::this_thread::get_id()] = name;
+    }
+
+    bool Write(const std::string& path)
+    {
+        std::ofstream out(path);
+        if (!out) {
+            std::cerr << "Trace: cannot write " << path << std::endl;
+            return false;
+        }
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << gpuTid
+            << ",\"args\":{\"name\":\"GPU\"}}";
+
+        size_t count = 0;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (auto& b : buffers) {
+            auto name = threadNames.find(b->thread);
+            out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << b->tid
+                << ",\"args\":{\"name\":\"" << escape(name != threadNames.end() ? name->second
+                    : "Thread " + std::to_string(b->tid)) << "\"}}";
+
+            uint64_t state = b->head.load(std::memory_order_acquire);
+            if ((uint32_t)(state >> 32) != generation.load(std::memory_order_relaxed)) continue;   // older capture
+            uint32_t head = (uint32_t)state;
+            uint32_t first = head > ringCapacity ? head - ringCapacity : 0;
+            for (uint32_t i = first; i < head; i++) {
+                const Event& e = b->events[i % ringCapacity];
+                out << ",\n{\"name\":\"" << escape(e.name) << "\",\"cat\":\"" << e.category
+                    << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.tid
+                    << ",\"ts\":" << e.startUs << ",\"dur\":" << e.durationUs << "}";
+                count++;
+            }
+        }
+        out << "\n]}\n";
+        std::cout << "Trace: wrote " << count << " events to " << path << std::endl;
+        return true;
+    }
+
+private:
+    struct ThreadBuffer
+    {
+        std::unique_ptr<Event[]> events{ new Event[ringCapacity] };    // not zeroed: pages are touched as they fill
+        std::atomic<uint64_t> head{ 0 };    // capture generation << 32 | events written
+        uint32_t tid = 0;
+        std::thread::id thread;
+    };
+
+    Clock::time_point epoch = Clock::now();
+    std::atomic<bool> recording{ false };
+    std::atomic<uint32_t> generation{ 0 };
+    int framesLeft = 0;
+    std::string outputPath;
+
+    double gpuOffsetUs = 0.0;
+    bool gpuCalibrated = false;
+
+    std::mutex registryMutex;     // only taken when a thread records for the first time (and by Write)
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::map<std::thread::id, std::string> threadNames;
+
+    // Ring of the calling thread, created on its first event
+    ThreadBuffer* threadBuffer()
+    {
+        thread_local ThreadBuffer* buffer = nullptr;
+        if (!buffer) {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            buffers.push_back(std::make_unique<ThreadBuffer>());
+            buffer = buffers.back().get();
+            buffer->tid = (uint32_t)buffers.size();
+            buffer->thread = std::this_thread::get_id();
+        }
+        return buffer;
+    }
+
+    void push(ThreadBuffer& b, const char* name, const char* category, double startUs, double durationUs, uint32_t tid)
+    {
+        // only this thread stores the head; a new generation starts the ring over
+        uint64_t state = b.head.load(std::memory_order_relaxed);
+        uint32_t current = generation.load(std::memory_order_relaxed);
+        uint32_t head = (uint32_t)(state >> 32) == current ? (uint32_t)state : 0;
+        Event& e = b.events[head % ringCapacity];
+        strncpy(e.name, name, sizeof(e.name) - 1);
+        e.name[sizeof(e.name) - 1] = '\0';
+        e.category = category;
+        e.startUs = startUs;
+        e.durationUs = durationUs;
+        e.tid = tid;
+        b.head.store((uint64_t)current << 32 | (head + 1), std::memory_order_release);
+    }
+
+    static std::string escape(const std::string& s)
+    {
+        std::string r;
+        for (char c : s) {
+            if (c == '"' || c == '\\') r += '\\';
+            r += c;
+        }
+        return r;
+    }
+};
+
+// RAII helper: records the enclosing block as a CPU event while a capture is running
+class TraceScope
+{
+public:
+    TraceScope(const char* name, const char* category) : name(name), category(category)
+    {
+        if (Tracer::Get().IsRecording()) startUs = Tracer::Get().NowUs();
+    }
+
+    ~TraceScope()
+    {
+        if (startUs >= 0.0) Tracer::Get().Record(name, category, startUs, Tracer::Get().NowUs() - startUs);
+    }
+
+private:
+    const char* name;
+    const char* category;
+    double startUs = -1.0;
+};
+
+#endif
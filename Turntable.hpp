@@ -0,0 +1,53 @@
+#ifndef TURNTABLE_H
+#define TURNTABLE_H
+
+#include "RenderTarget.hpp"
+#include "ImageWriter.hpp"
+#include "Readback.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <string>
+
+// Turntable export: a full orbit of the board (yaw 0..360) at a fixed pitch and
+// radius, written as a numbered PNG sequence. Rendering, PBO readback and PNG
+// encoding on the workers overlap, so frame N is encoded while frame N+1 renders.
+class Turntable
+{
+public:
+    bool enabled = false;
+    std::string outputDir = "turntable";
+    int frames = 120;
+    float pitch = 20.0f;
+    float radius = 8.0f;
+    float playbackFps = 30.0f;          // only used to report the speed against real time
+
+    float YawAt(int frame) const { return 360.0f * frame / frames; }
+
+    // renderFrame draws a frame with the given yaw into the currently bound target
+    bool Run(RenderTarget& target, AsyncReadback& readback, const std::function<void(float yaw)>& renderFrame)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(outputDir, ec);
+
+        std::atomic<bool> ok{ true };
+        double total = readback.CaptureSequence(target, frames, [&](int i) { renderFrame(YawAt(i)); },
+            [&](int i, std::vector<unsigned char>& pixels, int w, int h) {
+                char name[32];
+                snprintf(name, sizeof(name), "/frame_%04d.png", i);
+                if (!writePng(outputDir + name, w, h, 3, pixels.data(), true)) ok = false;
+            });
+
+        double fps = total > 0.0 ? frames / total : 0.0;
+        std::cout << "Turntable: " << frames << " frames (" << target.width << "x" << target.height << ") in "
+            << total << " s, " << fps << " fps, " << fps / playbackFps << "x real time at " << playbackFps
+            << " fps (readback latency " << readback.AverageLatencyFrames() << " frames, "
+            << readback.Stalls() << " stalls)" << std::endl;
+        return ok;
+    }
+};
+
+#endif
@@ -1,7 +1,12 @@
 #include <iostream>
 #include <string>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
 #include <vector>
 #include <cmath>
+#include <filesystem>
+#include <fstream>
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
@@ -17,6 +22,26 @@
 
 #include "Mesh.hpp"
 #include "Model.hpp"
+#include "FramePacer.hpp"
+#include "Profiler.hpp"
+#include "Trace.hpp"
+#include "Benchmark.hpp"
+#include "RenderTarget.hpp"
+#include "ImageWriter.hpp"
+#include "BatchRenderer.hpp"
+#include "Readback.hpp"
+#include "ThreadPool.hpp"
+#include "Turntable.hpp"
+#include "PosterRenderer.hpp"
+#include "DynamicResolution.hpp"
+#include "MaterialBaker.hpp"
+#include "ProgramCache.hpp"
+#include "ShaderCompiler.hpp"
+#include "ShaderVariants.hpp"
+#include "MaterialTable.hpp"
+#include "MaterialNoise.hpp"
+#include "MaterialProfiler.hpp"
+#include "NoiseLut.hpp"
 
 // ---------------------------------------------------
 // Global variables
@@ -25,11 +50,9 @@ int         gWindowWidth = 1280;
 int         gWindowHeight = 720;
 int materialBlack = 1; 
 int materialWhite = 1;
-const int maxMaterialsPieces = 3;
 int materialBlackSquares = 1; 
 int materialWhiteSquares = 1;
 int materialBase = 1; 
-const int maxMaterials = 2; 
 
 
 // Matrices
@@ -59,6 +82,113 @@ float zoomSpeed = 1.0f;
 // The orbit center
 glm::vec3 orbitCenter(0.f, 0.f, 0.f);
 
+// Render on demand: redraw only when input, a callback or the UI marks the frame dirty
+bool   renderOnDemand = false;
+int    redrawFrames = 3;              // frames left to draw before going idle
+const double idleWaitTimeout = 0.5;   // max seconds to sleep in glfwWaitEventsTimeout
+
+void requestRedraw(int frames = 3)
+{
+    // ImGui needs a couple of frames to settle hover/click states after an event
+    if (frames > redrawFrames) redrawFrames = frames;
+}
+
+// Frame pacing (vsync, frame cap, background throttling)
+FramePacer framePacer;
+
+// CPU/GPU frame profiler
+Profiler profiler;
+bool     showProfiler = false;
+
+// Chrome trace capture
+int         traceFrames = 120;
+std::string tracePath = "trace.json";
+int         traceCaptureCount = 0;
+
+// Deterministic camera-path benchmark
+Benchmark benchmark;
+
+// Headless rendering: no display, GLFW null platform with an EGL or OSMesa context
+bool        headless = false;
+std::string headlessApi = "egl";
+std::string outputPath = "render.png";
+
+// Batch thumbnail rendering
+std::string   batchFile;
+BatchRenderer batch;
+
+// Turntable image sequence export
+Turntable turntable;
+
+// Tiled rendering of stills larger than the GPU limits
+PosterRenderer poster;
+
+// Asynchronous readback for screenshots and continuous capture; encoding runs on the workers
+std::unique_ptr<ThreadPool> workerPool;    // created in main, not during static initialisation
+AsyncReadback readback;
+bool          screenshotRequested = false;
+int           screenshotCount = 0;
+bool          continuousCapture = false;
+int           captureFrame = 0;
+std::string   captureDir = "capture";
+
+// Dynamic resolution of the 3D scene
+DynamicResolution dynamicResolution;
+
+// Frustum culling of the model's meshes
+bool frustumCulling = true;
+int  meshesCulled = 0;
+int  meshesTotal = 0;
+
+// Baked materials: procedural materials rendered once into textures, shading is a texture fetch
+bool          bakedMaterials = true;
+GLuint        texturedProgram = 0;
+MaterialBaker materialBaker;
+ShaderVariants sceneVariants;           // procedural shading, one program per material pattern
+ShaderVariants bakeVariants;            // material bake, same permutations
+MaterialTable materialTable;            // material records, indexed by the shaders through a uniform block
+std::string   materialTableFile = "materials.txt";
+ProgramCache  programCache;             // linked program binaries kept across runs
+ShaderCompiler shaderCompiler;          // asynchronous compiles, KHR_parallel_shader_compile when available
+bool          separableShaders = true;  // procedural variants as program pipelines sharing the noise library
+bool          noiseLut = false;         // value noise from a precomputed lattice texture instead of sin() hashes
+NoiseLut      noiseLutTexture;
+bool          adaptiveOctaves = true;   // stop the noise octaves at the pixel footprint
+const int     noiseLutUnit = 1;         // unit 0 is the baked material texture
+std::string   noiseLutBenchDir;         // non-empty: A/B benchmark of the two noise paths, images written here
+bool          materialCost = false;     // GPU cost of every material choice, then exit
+std::string   materialCostCsv;          // non-empty: the cost table is also written here
+bool          cpuBakeCheck = false;     // compare the CPU port with a GPU bake of every noise material, then exit
+bool          cpuBake = false;          // generate baked textures with the SIMD CPU port
+int           noiseBenchSize = 0;       // > 0: run the CPU noise benchmark and exit
+
+// Depth pre-pass: lay down depth with a trivial shader, then shade each visible pixel once
+bool   depthPrepass = false;
+GLuint depthProgram = 0;
+
+// Camera uniform buffer, shared by every program through binding point 0
+struct CameraBlock
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec4 cameraDir;
+};
+GLuint cameraUBO = 0;
+const GLuint cameraBinding = 0;
+const GLuint materialsBinding = 1;      // MaterialTable
+
+// Low latency mode: poll input right before the scene draw and wait for the GPU after swap
+bool   lowLatency = false;
+double pendingInputTime = -1.0;   // oldest camera input not rendered yet
+double latencyLastMs = 0.0;       // input event -> swap
+double latencyAvgMs = 0.0;
+double latencyMaxMs = 0.0;
+
+void markCameraInput()
+{
+    if (pendingInputTime < 0.0) pendingInputTime = glfwGetTime();
+}
+
 
 static const char* vsSrc = R".(
 #version 330 core
@@ -67,12 +197,20 @@ layout(location = 1) in vec3 aNormal;
 layout(location = 2) in vec2 aTexCoords;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+layout(std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    vec4 cameraDir;
+};
 
 out vec3 Normal;
 out vec2 TexCoords;
 
+// same position as the depth pre-pass, bit for bit, so GL_EQUAL passes
+invariant gl_Position;
+
 void main()
 {
     gl_Position = projection * view * model * vec4(aPos, 1.0);
@@ -80,21 +218,83 @@ void main()
     TexCoords = aTexCoords;
 }
 ).";
-static const char* fsSrc2 = R".(
+// Depth pre-pass: position only, no shading
+static const char* vsDepthSrc = R".(
+#version 330 core
+layout(location = 0) in vec3 aPos;
+
+uniform mat4 model;
+
+layout(std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    vec4 cameraDir;
+};
+
+invariant gl_Position;
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+}
+).";
+static const char* fsDepthSrc = R".(
+#version 330 core
+void main()
+{
+}
+).";
+// Fragment shaders are assembled from the pieces below:
+//   scene shading:  fsHeaderSrc + materialLibSrc + materialColorSrc + lightingSrc + fsProceduralMainSrc
+//   baked shading:  fsHeaderSrc + lightingSrc + fsTexturedMainSrc
+//   material bake:  fsBakeHeaderSrc + materialLibSrc + materialColorSrc + fsBakeMainSrc
+// Sources with materialColorSrc are compiled once per material pattern by ShaderVariants.
+// With separate shader objects the scene shading is split into a library compiled once,
+//   fsHeaderSrc + materialLibSrc + lightingSrc,
+// and a small stage per variant: fsHeaderSrc + materialDeclSrc + materialColorSrc + fsProceduralMainSrc
+static const char* fsHeaderSrc = R".(
 #version 330 core
 
 in vec2 TexCoords; // Texture coordinates from vertex shader
 in vec3 Normal;    // Normal for lighting calculations
 
 out vec4 FragColor; // Output color
-uniform vec3 cameraDir;
-uniform int uMaterialID; // Determines which material to use
-uniform int uMaterialBlack;
-uniform int uMaterialWhite;
-uniform int uMaterialWhiteSquares;
-uniform int uMaterialBlackSquares;
-uniform int uMaterialBoard;
 
+layout(std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    vec4 cameraDir;
+};
+).";
+// Procedural materials: noise and pattern functions
+static const char* materialLibSrc = R".(
+
+#ifdef NOISE_LUT
+// Precomputed lattice values (NoiseLut.hpp), wrapping every 256 cells:
+// corners (x, y), (x+1, y), (x, y+1), (x+1, y+1) of a cell
+uniform sampler2D uNoiseLut;
+vec4 latticeCorners(vec2 cell) {
+    return texelFetch(uNoiseLut, ivec2(mod(cell, 256.0)), 0);
+}
+#endif
+
+// Octaves of a fractal sum finer than the pixel footprint of the noise
+// coordinate only alias. octaveLimit() is the fractional number of octaves
+// still above it (a lattice cell covering at least two pixels); the loops
+// fade the last one in and replace the rest by their average.
+// FULL_OCTAVES keeps every octave.
+float footprint(vec2 p) { vec2 w = fwidth(p); return max(w.x, w.y); }
+float footprint(vec3 p) { vec3 w = fwidth(p); return max(max(w.x, w.y), w.z); }
+
+float octaveLimit(float footprint, float frequency, float lacunarity) {
+#ifdef FULL_OCTAVES
+    return 1e9;
+#else
+    return log2(0.5 / max(footprint * frequency, 1e-9)) / log2(lacunarity) + 1.0;
+#endif
+}
 
 //Marble 
 float hash(vec2 p) {
@@ -107,32 +307,40 @@ float noise(vec2 p) {
     vec2 f = fract(p);
     vec2 u = f * f * (3.0 - 2.0 * f);
 
+#ifdef NOISE_LUT
+    vec4 h = latticeCorners(i);
+    return mix(mix(h.x, h.y, u.x), mix(h.z, h.w, u.x), u.y);
+#else
     return mix(
         mix(hash(i + vec2(0.0, 0.0)), hash(i + vec2(1.0, 0.0)), u.x),
         mix(hash(i + vec2(0.0, 1.0)), hash(i + vec2(1.0, 1.0)), u.x),
         u.y
     );
+#endif
 }
 
-float turbulence(vec2 p) {
+float turbulence(vec2 p, int octaves) {
     float t = 0.0;
     float scale = 2; // Higher frequency
-    for (int i = 0; i < 7; i++) { // More octaves
-        t += abs(noise(p * scale) - 0.5) / scale;
+    float limit = octaveLimit(footprint(p), scale, 2.5);
+    for (int i = 0; i < octaves; i++) {
+        float w = clamp(limit - float(i), 0.0, 1.0);
+        float n = w > 0.0 ? abs(noise(p * scale) - 0.5) : 0.25; // 0.25: average
+        t += mix(0.25, n, w) / scale;
         scale *= 2.5; // Increase scaling factor
     }
     return t;
 }
 
-float marbleVeins(vec2 p) {
-    float t = turbulence(p);
+float marbleVeins(vec2 p, int octaves) {
+    float t = turbulence(p, octaves);
     float veins = sin(p.x * 2 + t * 80.0); // Adjust frequency and amplitude
     veins = smoothstep(0.9, 0.95, veins);  // Narrower range for sparse veins
     return veins;
 }
 
-vec3 marbleColor(vec2 uv, vec3 baseColor, vec3 veinColor) {
-    float veins = marbleVeins(uv);
+vec3 marbleColor(vec2 uv, vec3 baseColor, vec3 veinColor, int octaves) {
+    float veins = marbleVeins(uv, octaves);
     return mix(baseColor, veinColor, veins); // Reduce vein intensity
 }
 
@@ -161,10 +369,18 @@ float n31(vec3 p) {
 	vec3 ip = floor(p);
 	p = fract(p);
 	p = p * p * (3. - 2. * p);
+#ifdef NOISE_LUT
+	// slice z of the lattice is the 2D table shifted by z * (37, 17)
+	vec2 cell = ip.xy + ip.z * vec2(37, 17);
+	vec4 h = mix(latticeCorners(cell), latticeCorners(cell + vec2(37, 17)), p.z);
+	h.xy = mix(h.xy, h.zw, p.y);
+	return mix(h.x, h.y, p.x);
+#else
 	vec4 h = vec4(0, s.yz, sum2(s.yz)) + dot(ip, s);
 	h = mix(fract(sin(h) * 43758.545), fract(sin(h + s.x) * 43758.545), p.x);
 	h.xy = mix(h.xz, h.yw, p.y);
 	return mix(h.x, h.y, p.z);
+#endif
 }
 
 // roughness: (0.0, 1.0], default: 0.5
@@ -174,8 +390,11 @@ float fbm(vec3 p, int octaves, float roughness) {
 	      amp = 1.,
 	      tot = 0.;
 	roughness = sat(roughness);
+	float limit = octaveLimit(footprint(p), 1., 2.);
 	for (int i = 0; i < octaves; i++) {
-		sum += amp * n31(p);
+		float w = sat(limit - float(i));
+		float n = w > 0. ? n31(p) : .5;
+		sum += amp * mix(.5, n, w);
 		tot += amp;
 		amp *= roughness;
 		p *= 2.;
@@ -189,9 +408,9 @@ vec3 randomPos(float seed) {
 }
 
 // Returns unsigned noise [0.0, 1.0]
-float fbmDistorted(vec3 p) {
+float fbmDistorted(vec3 p, int octaves) {
 	p += (vec3(n31(p + randomPos(0.)), n31(p + randomPos(1.)), n31(p + randomPos(2.))) * 2. - 1.) * 1.12;
-	return fbm(p, 8, .5);
+	return fbm(p, octaves, .5);
 }
 
 // vec3: detail(/octaves), dimension(/inverse contrast), lacunarity
@@ -200,9 +419,12 @@ float musgraveFbm(vec3 p, float octaves, float dimension, float lacunarity) {
 	float sum = 0.,
 	      amp = 1.,
 	      m = pow(lacunarity, -dimension);
+	float limit = octaveLimit(footprint(p), 1., lacunarity);
 	for (float i = 0.; i < octaves; i++) {
+		float w = sat(limit - i);
+		if (w <= 0.) break;     // signed noise: the average of the rest is 0
 		float n = n31(p) * 2. - 1.;
-		sum += n * amp;
+		sum += n * amp * w;
 		amp *= m;
 		p *= lacunarity;
 	}
@@ -222,8 +444,8 @@ float remap01(float f, float in1, float in2) { return sat((f - in1) / (in2 - in1
 
 ///////////////////////////////////////////////////////////////////////////////
 // Wood material.
-vec3 matWood(vec3 p, vec3 baseColor, vec3 midColor, vec3 highlightColor) {
-    float n1 = fbmDistorted(p * vec3(7.8, 1.17, 1.17));
+vec3 matWood(vec3 p, vec3 baseColor, vec3 midColor, vec3 highlightColor, int octaves) {
+    float n1 = fbmDistorted(p * vec3(7.8, 1.17, 1.17), octaves);
     n1 = mix(n1, 1., .2);
     float n2 = mix(musgraveFbm(vec3(n1 * 4.6), 8., 0., 2.5), n1, .85),
           dirt = 1. - musgraveFbm(waveFbmX(p * vec3(.01, .15, .15)), 15., .26, 2.4) * .4;
@@ -235,142 +457,53 @@ vec3 matWood(vec3 p, vec3 baseColor, vec3 midColor, vec3 highlightColor) {
 }
 
 
-// Main material logic
-void main() {
-    vec2 uv = TexCoords; // Scale texture coordinates
-    vec3 color = vec3(1.0);     // Default white color
-     if (uMaterialID == 1) {
-switch(uMaterialWhite){
-       case 1: 
-         color =vec3(0.75,0.75,0.75);
-        break;
-        case 2: 
-         vec3 baseColor = vec3(0.9);          // White marble base
-        vec3 veinColor = vec3(0.3, 0.3, 0.3); // Dark gray veins
-         uv *=15;
-        color = marbleColor(uv, baseColor, veinColor);
-        break;
-case 3:
-uv *=2;
-vec3 p = vec3((uv - 0.5) * 2.0, floor(mod(0, 8.0)));
-vec3 woodColor = pow(matWood(p, 
-    vec3(0.40, 0.32, 0.20),  // Base color: Pi scuro
-    vec3(0.55, 0.44, 0.28),  // Mid-tone color: Pi scuro del colore principale
-    vec3(0.70, 0.56, 0.36)   // Highlight color: Riflessi pi scuri
-), vec3(.4545));
- color = woodColor;
-break;
-    }}
-    else if (uMaterialID == 2) {
-       /* // Black material*/
-      switch(uMaterialBlack){
-       case 1: 
-         color =vec3(0.25,0.25,0.25);
-        break;
-        case 2: 
-        vec3 baseColor = vec3(0.25);         
-        vec3 veinColor = vec3(0.8, 0.8, 0.8); 
-        uv *=15;
-        color = marbleColor(uv, baseColor, veinColor);
-        break;
-case 3:
-uv *= 2;
-vec3 p = vec3((uv - 0.5) * 2.0, floor(mod(0, 8.0)));
-vec3 woodColor = pow(matWood(p, 
-    vec3(0.15, 0.05, 0.03),  // Base color: Molto scuro
-    vec3(0.30, 0.10, 0.05),  // Mid-tone color: Pi scuro del colore principale
-    vec3(0.40, 0.15, 0.08)   // Highlight color: Riflessi scuri
-), vec3(.4545));
- color = woodColor;
-break;
-    }
-
-    
-      
-    } else if (uMaterialID == 3) {
-    switch(uMaterialBoard){
-    case 1: 
-color = vec3(0.40, 0.26, 0.13);
-break;
-case 2:
-vec3 p = vec3((uv - 0.5) * 2.0, floor(mod(0, 8.0)));
-   vec3 baseColor = vec3(0.10, 0.05, 0.02);      // Fondo del legno scuro
-vec3 midColor = vec3(0.30, 0.15, 0.07);       // Tono intermedio
-vec3 highlightColor = vec3(0.45, 0.25, 0.12); // Venature chiare
-vec3 woodColor = pow(matWood(p, baseColor, midColor, highlightColor), vec3(.4545));
-color = woodColor;
-break;
-case 3: 
-uv *=.25;
- p = vec3((uv - 0.5) * 2.0, floor(mod(0, 8.0)));
- woodColor = pow(
-    matWood(
-        p,
-        vec3(0.02, 0.05, 0.10),  // Fondo del legno blu scuro
-        vec3(0.07, 0.15, 0.30),  // Tono intermedio
-        vec3(0.12, 0.25, 0.45)   // Venature chiare
-    ),
-    vec3(0.4545)
-);
-color = woodColor;
-break;
-}
-
-    }
-else if (uMaterialID == 4) {
-switch(uMaterialWhiteSquares){
-case 1:
-color = vec3(0.75);
-break;
-case 2: 
-uv *=.25;
-vec3 p = vec3((uv - 0.5) * 2.0, floor(mod(0, 8.0)));
-   vec3 woodColor = pow(matWood(p, 
-    vec3(0.9, 0.9, 0.85),  // Base color
-    vec3(0.8, 0.8, 0.75),  // Mid-tone color
-    vec3(1.0, 1.0, 0.95)   // Highlight color
-), vec3(.4545));
- color = woodColor;
-break;}
-
-    }
-else if (uMaterialID == 5) {
-switch(uMaterialBlackSquares){
-case 1: 
-color = vec3(0.25);
-break; 
-case 2: 
-uv *=.25;
-vec3 p = vec3((uv - 0.5) * 2.0, floor(mod(0, 8.0)));
-   vec3 baseColor = vec3(0.10, 0.05, 0.02);      // Fondo del legno scuro
-vec3 midColor = vec3(0.30, 0.15, 0.07);       // Tono intermedio
-vec3 highlightColor = vec3(0.45, 0.25, 0.12); // Venature chiare
-vec3 woodColor = pow(matWood(p, baseColor, midColor, highlightColor), vec3(.4545));
-color = woodColor;
-break;
-case 3: 
-uv *=.25;
- p = vec3((uv - 0.5) * 2.0, floor(mod(0, 8.0)));
- woodColor = pow(
-    matWood(
-        p,
-        vec3(0.02, 0.05, 0.10),  // Fondo del legno blu scuro
-        vec3(0.07, 0.15, 0.30),  // Tono intermedio
-        vec3(0.12, 0.25, 0.45)   // Venature chiare
-    ),
-    vec3(0.4545)
-);
-color = woodColor;
-break;
-
-}
-
-    }
- else {
-        // Default fallback
-        color = vec3(0,1,0);
-    }
+).";
+// Material selection, specialized per pattern (ShaderVariants.hpp)
+static const char* materialColorSrc = R".(
+// Main material logic. The parameters of every material are records of the
+// material table (MaterialTable.hpp), picked by uMaterialIndex; each program is
+// specialized for one pattern with MATERIAL_PATTERN (see ShaderVariants.hpp),
+// so nothing is decided per fragment and new materials need no new program.
+#ifndef MATERIAL_PATTERN
+#define MATERIAL_PATTERN 0
+#endif
+#ifndef MAX_MATERIALS
+#define MAX_MATERIALS 32    // MaterialTable::maxRecords
+#endif
+
+struct Material {
+    vec4 colors[3];     // flat: color; marble: base, vein; wood: base, mid, highlight
+    vec4 params;        // x = uv scale, y = octaves, z = pattern
+};
+layout(std140) uniform Materials
+{
+    Material materials[MAX_MATERIALS];
+};
+uniform int uMaterialIndex;
+
+vec3 materialColor(vec2 uv) {
+    Material m = materials[uMaterialIndex];
+    uv *= m.params.x;
+    int octaves = int(m.params.y);
+#if MATERIAL_PATTERN == 1
+    return marbleColor(uv, m.colors[0].rgb, m.colors[1].rgb, octaves);
+#elif MATERIAL_PATTERN == 2
+    vec3 p = vec3((uv - 0.5) * 2.0, 0.0);
+    return pow(matWood(p, m.colors[0].rgb, m.colors[1].rgb, m.colors[2].rgb, octaves), vec3(.4545));
+#else
+    return m.colors[0].rgb;
+#endif
+}
+).";
+// What a material stage uses from the shared library
+static const char* materialDeclSrc = R".(
+vec3 marbleColor(vec2 uv, vec3 baseColor, vec3 veinColor, int octaves);
+vec3 matWood(vec3 p, vec3 baseColor, vec3 midColor, vec3 highlightColor, int octaves);
+vec4 applyLighting(vec3 color);
+).";
+static const char* lightingSrc = R".(
 // Add basic lighting (Phong reflection model)
+vec4 applyLighting(vec3 color) {
 // Ambient
   vec3 ambient = vec3(0.5, 0.5, 0.5);
 
@@ -382,7 +515,7 @@ vec3 diffuse = diffuseStrength * color;
 
 //Specular 
 vec3 cameraSource = vec3(0.0, 0.0, 1.0);
-  vec3 viewSource = normalize(cameraDir);
+  vec3 viewSource = normalize(cameraDir.xyz);
   vec3 reflectSource = normalize(reflect(-lightSource, normal));
   float specularStrength = max(0.0, dot(viewSource, reflectSource));
   specularStrength = pow(specularStrength, 256.0);
@@ -391,61 +524,110 @@ vec3 cameraSource = vec3(0.0, 0.0, 1.0);
  vec3 lighting = ambient * 0.5 + diffuse * 0.5 + specular * 0.5;
 
 vec3 finalColor = ambient + diffuse ;
-FragColor = vec4(color*lighting, 1.0);
+return vec4(color*lighting, 1.0);
 }
 ).";
+static const char* fsProceduralMainSrc = R".(
+void main() {
+    FragColor = applyLighting(materialColor(TexCoords));
+}
+).";
+// Baked materials: one texture fetch over the material's UV rectangle
+static const char* fsTexturedMainSrc = R".(
+uniform sampler2D uMaterialTexture;
+uniform vec4 uUvRect; // xy = min, zw = size
 
+void main() {
+    vec2 uv = (TexCoords - uUvRect.xy) / uUvRect.zw;
+    FragColor = applyLighting(texture(uMaterialTexture, uv).rgb);
+}
+).";
+// Material bake: a full-screen triangle over the UV rectangle of a material
+static const char* vsBakeSrc = R".(
+#version 330 core
+uniform vec4 uUvRect; // xy = min, zw = size
 
+out vec2 BakeUV;
 
-GLuint createShader(GLenum type, const char* src)
+void main()
 {
-    GLuint shader = glCreateShader(type);
-    glShaderSource(shader, 1, &src, nullptr);
-    glCompileShader(shader);
-
-    // Check compilation
-    GLint success;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        char infoLog[512];
-        glGetShaderInfoLog(shader, 512, nullptr, infoLog);
-        std::cerr << "ERROR Shader compilation: " << infoLog << std::endl;
-    }
-    return shader;
+    vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    BakeUV = uUvRect.xy + p * uUvRect.zw;
+    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);
+}
+).";
+static const char* fsBakeHeaderSrc = R".(
+#version 330 core
+in vec2 BakeUV;
+out vec4 FragColor;
+).";
+static const char* fsBakeMainSrc = R".(
+void main() {
+    FragColor = vec4(materialColor(BakeUV), 1.0);
 }
+).";
+
 
+
+// Program from the binary cache when possible, compiled from source otherwise
 GLuint createProgram(const char* vs, const char* fs)
 {
-    GLuint vshader = createShader(GL_VERTEX_SHADER, vs);
-    GLuint fshader = createShader(GL_FRAGMENT_SHADER, fs);
-    GLuint program = glCreateProgram();
-    glAttachShader(program, vshader);
-    glAttachShader(program, fshader);
-    glLinkProgram(program);
+    return shaderCompiler.Build(vs, fs);
+}
 
-    // check linking
-    GLint success;
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    if (!success) {
-        char infoLog[512];
-        glGetProgramInfoLog(program, 512, nullptr, infoLog);
-        std::cerr << "ERROR Program linking: " << infoLog << std::endl;
+// Startup cost of the programs built so far
+void reportProgramCache()
+{
+    if (!programCache.Supported()) {
+        std::cout << "Program cache: program binaries not supported by the driver" << std::endl;
+        return;
     }
-    glDeleteShader(vshader);
-    glDeleteShader(fshader);
-    return program;
+    if (!programCache.enabled) return;
+    std::cout << "Program cache: " << programCache.Hits() << " loaded in " << programCache.LoadMs() << " ms, "
+        << programCache.Misses() << " compiled";
+    if (programCache.Rejected()) std::cout << " (" << programCache.Rejected() << " stale)";
+    std::cout << ", " << programCache.SavedMs() << " ms of compile time saved" << std::endl;
 }
 
 
+// Perspective projection for the current window aspect ratio
+void updateProjection()
+{
+    if (gWindowWidth <= 0 || gWindowHeight <= 0) return;   // minimized
+    gProjection = glm::perspective(glm::radians(45.0f),
+        (float)gWindowWidth / (float)gWindowHeight,
+        0.1f, 100.0f);
+}
+
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     gWindowWidth = width;
     gWindowHeight = height;
     glViewport(0, 0, width, height);
+    // the dynamic resolution target follows on its next frame
+    updateProjection();
+    requestRedraw();
+}
+
+void window_refresh_callback(GLFWwindow* window)
+{
+    requestRedraw();
+}
+
+void window_focus_callback(GLFWwindow* window, int focused)
+{
+    requestRedraw();
+}
+
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    requestRedraw();
+    if (key == GLFW_KEY_F12 && action == GLFW_PRESS) screenshotRequested = true;
 }
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 {
+    requestRedraw();
     if (button == GLFW_MOUSE_BUTTON_RIGHT) {
         if (action == GLFW_PRESS) {
             rightClickPressed = true;
@@ -459,6 +641,7 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 
 void cursor_position_callback(GLFWwindow* window, double xpos, double ypos)
 {
+    requestRedraw(); // hover states in the UI change too
     if (!rightClickPressed) return; // only rotate if right click is down
 
     float xoffset = (float)xpos - (float)lastX;
@@ -477,15 +660,18 @@ void cursor_position_callback(GLFWwindow* window, double xpos, double ypos)
     // clamp pitch
     if (pitch > 89.9f)  pitch = 89.9f;
     if (pitch < -89.9f) pitch = -89.9f;
+    markCameraInput();
 }
 
 // Scroll for zoom in/out
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
+    requestRedraw();
     // Increase or decrease the orbit radius
     radius -= (float)yoffset * zoomSpeed;
     if (radius < 1.0f)  radius = 1.0f;
     if (radius > 100.f) radius = 100.f;
+    markCameraInput();
 }
 
 void processInput(GLFWwindow* window)
@@ -495,9 +681,104 @@ void processInput(GLFWwindow* window)
         glfwSetWindowShouldClose(window, true);
 }
 
+// ---------------------------------------------------
+// Camera uniform buffer
+void createCameraBuffer()
+{
+    glGenBuffers(1, &cameraUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, cameraUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, cameraBinding, cameraUBO);
+}
+
+void bindCameraBlock(GLuint program)
+{
+    GLuint blockIndex = glGetUniformBlockIndex(program, "Camera");
+    if (blockIndex != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, blockIndex, cameraBinding);
+}
+
+// Camera block, material table and noise table unit of a material program
+void setupMaterialProgram(GLuint program)
+{
+    bindCameraBlock(program);
+    GLuint materialsIndex = glGetUniformBlockIndex(program, "Materials");
+    if (materialsIndex != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, materialsIndex, materialsBinding);
+    GLint lutLoc = glGetUniformLocation(program, "uNoiseLut");
+    if (lutLoc >= 0) {
+        glUseProgram(program);
+        glUniform1i(lutLoc, noiseLutUnit);
+    }
+}
+
+// (Re)build the procedural material programs for the current options;
+// async: interactive use, variants are drawn with a fallback until ready
+void buildMaterialShaders(bool async)
+{
+    std::string defines = noiseLut ? "#define NOISE_LUT\n" : "";
+    if (!adaptiveOctaves) defines += "#define FULL_OCTAVES\n";
+    std::string fsProcedural = ShaderVariants::Specialize(std::string(fsHeaderSrc) + materialLibSrc +
+        materialColorSrc + lightingSrc + fsProceduralMainSrc, defines);
+    std::string fsBake = ShaderVariants::Specialize(std::string(fsBakeHeaderSrc) + materialLibSrc +
+        materialColorSrc + fsBakeMainSrc, defines);
+    std::string fsLibrary = ShaderVariants::Specialize(std::string(fsHeaderSrc) + materialLibSrc + lightingSrc, defines);
+    std::string fsStage = std::string(fsHeaderSrc) + materialDeclSrc + materialColorSrc + fsProceduralMainSrc;
+
+    if (!separableShaders || !sceneVariants.InitPipelines(vsSrc, fsLibrary, fsStage, &shaderCompiler, setupMaterialProgram))
+        sceneVariants.Init(vsSrc, fsProcedural, &shaderCompiler, setupMaterialProgram);
+    bakeVariants.Init(vsBakeSrc, fsBake, &shaderCompiler, setupMaterialProgram);
+    materialBaker.Init(&bakeVariants, fsBake, &materialTable);
+
+    sceneVariants.async = async;
+    // without parallel compilation any variant built later would stall a frame,
+    // so all of them are built now, even if only the baked materials are shown
+    if (async && (!bakedMaterials || !shaderCompiler.Parallel())) sceneVariants.SubmitAll(MaterialParams::PatternCount);
+}
+
+// Rebuild gView from yaw, pitch, radius and upload it; the GPU reads it at draw time
+void updateCamera()
+{
+    // Recompute cameraPos from yaw, pitch, radius, plus cameraOffset
+    float radYaw = glm::radians(yaw);
+    float radPitch = glm::radians(pitch);
+
+    float x = radius * cos(radPitch) * sin(radYaw);
+    float y = radius * sin(radPitch);
+    float z = radius * cos(radPitch) * cos(radYaw);
+
+    glm::vec3 position = orbitCenter + glm::vec3(x, y, z) + cameraOffset;
+    glm::vec3 front = glm::normalize(orbitCenter + cameraOffset - position);
+    glm::vec3 cameraDir = glm::normalize(position - orbitCenter);
+
+    // build the view matrix
+    gView = glm::lookAt(position, position + front, glm::vec3(0.f, 1.f, 0.f));
+
+    CameraBlock block = { gView, gProjection, glm::vec4(cameraDir, 0.0f) };
+    glBindBuffer(GL_UNIFORM_BUFFER, cameraUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), &block, GL_DYNAMIC_DRAW); // orphan + upload
+}
+
+// Benchmark mode: scripted camera and material schedule instead of user input
+void applyBenchmarkFrame(int frame)
+{
+    Benchmark::CameraPose pose = benchmark.CameraAt(frame);
+    yaw = pose.yaw;
+    pitch = pose.pitch;
+    radius = pose.radius;
+
+    int step = benchmark.MaterialStepAt(frame);
+    materialWhite = 1 + step % materialTable.Choices(1);
+    materialBlack = 1 + (step + 1) % materialTable.Choices(2);
+    materialBase = 1 + (step + 2) % materialTable.Choices(3);
+    materialWhiteSquares = 1 + step % materialTable.Choices(4);
+    materialBlackSquares = 1 + (step + 1) % materialTable.Choices(5);
+}
+
 // ---------------------------------------------------
 bool initWindowAndGL()
 {
+    if (headless) glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
     if (!glfwInit()) {
         std::cerr << "Failed to init GLFW\n";
         return false;
@@ -505,6 +786,15 @@ bool initWindowAndGL()
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    if (headless) {
+        // EGL surfaceless or OSMesa: no display server needed
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API,
+            headlessApi == "osmesa" ? GLFW_OSMESA_CONTEXT_API : GLFW_EGL_CONTEXT_API);
+    }
+    if (benchmark.enabled || headless || !batchFile.empty() || turntable.enabled || poster.enabled) {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    }
 
     gWindow = glfwCreateWindow(gWindowWidth, gWindowHeight, "PGRe Project", nullptr, nullptr);
     if (!gWindow) {
@@ -514,6 +804,9 @@ bool initWindowAndGL()
     }
     glfwMakeContextCurrent(gWindow);
     glfwSetFramebufferSizeCallback(gWindow, framebuffer_size_callback);
+    glfwSetWindowRefreshCallback(gWindow, window_refresh_callback);
+    glfwSetWindowFocusCallback(gWindow, window_focus_callback);
+    glfwSetKeyCallback(gWindow, key_callback);
 
     // set up mouse
     glfwSetMouseButtonCallback(gWindow, mouse_button_callback);
@@ -524,40 +817,998 @@ bool initWindowAndGL()
         std::cerr << "Failed to init GLAD\n";
         return false;
     }
+    programCache.Init((GLADloadproc)glfwGetProcAddress);
+    shaderCompiler.Init((GLADloadproc)glfwGetProcAddress, &programCache);
     glEnable(GL_DEPTH_TEST);
     glViewport(0, 0, gWindowWidth, gWindowHeight);
 
     return true;
 }
 
+// ---------------------------------------------------
+// Relate GL_TIMESTAMP values to the trace clock
+void calibrateTraceGpuClock()
+{
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    Tracer::Get().CalibrateGpu((uint64_t)gpuNow);
+}
+
+// Start recording a Chrome trace of the next frames (frames <= 0: until stopped)
+void startTrace(int frames, const std::string& path)
+{
+    calibrateTraceGpuClock();
+    Tracer::Get().Start(frames, path);
+}
+
+// ---------------------------------------------------
+// Performance window: frame pacing controls and statistics
+void drawPerformanceWindow()
+{
+    ImGui::SetNextWindowPos(ImVec2(gWindowWidth - 330.f, 10.f), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowSize(ImVec2(320, 0), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowCollapsed(true, ImGuiCond_FirstUseEver);
+    ImGui::Begin("Performance");
+
+    if (ImGui::CollapsingHeader("Frame pacing", ImGuiTreeNodeFlags_DefaultOpen)) {
+        bool vsync = framePacer.vsync;
+        if (ImGui::Checkbox("VSync", &vsync)) framePacer.SetVSync(vsync);
+        ImGui::SliderFloat("FPS cap", &framePacer.fpsCap, 0.0f, 240.0f, framePacer.fpsCap > 0.0f ? "%.0f" : "off");
+        ImGui::Checkbox("Throttle in background", &framePacer.throttleInBackground);
+        ImGui::Checkbox("Render on demand", &renderOnDemand);
+        ImGui::Checkbox("Show profiler", &showProfiler);
+
+        ImGui::Text("Frame %.2f ms  jitter %.2f ms  max dev %.2f ms",
+            framePacer.AverageFrameMs(), framePacer.JitterMs(), framePacer.MaxDeviationMs());
+        ImGui::PlotLines("##frametimes", framePacer.History(), FramePacer::historySize,
+            framePacer.HistoryOffset(), nullptr, 0.0f, 50.0f, ImVec2(0, 60));
+    }
+
+    if (ImGui::CollapsingHeader("Input latency", ImGuiTreeNodeFlags_DefaultOpen)) {
+        ImGui::Checkbox("Low latency mode", &lowLatency);
+        ImGui::Text("Input -> swap  last %.1f ms  avg %.1f ms  max %.1f ms",
+            latencyLastMs, latencyAvgMs, latencyMaxMs);
+        if (ImGui::Button("Reset##latency")) latencyAvgMs = latencyMaxMs = latencyLastMs = 0.0;
+    }
+
+    if (ImGui::CollapsingHeader("Culling")) {
+        ImGui::Checkbox("Frustum culling", &frustumCulling);
+        ImGui::Text("Culled %d / %d meshes", meshesCulled, meshesTotal);
+    }
+
+    if (ImGui::CollapsingHeader("Materials")) {
+        ImGui::Checkbox("Baked materials", &bakedMaterials);
+        static const int bakeSizes[] = { 256, 512, 1024, 2048, 4096 };
+        static const char* bakeSizeNames[] = { "256", "512", "1024", "2048", "4096" };
+        int sizeIndex = 0;
+        while (sizeIndex < 4 && bakeSizes[sizeIndex] < materialBaker.size) sizeIndex++;
+        if (ImGui::Combo("Bake size", &sizeIndex, bakeSizeNames, 5)) {
+            materialBaker.size = bakeSizes[sizeIndex];
+            materialBaker.Clear();
+        }
+        if (ImGui::Button("Re-bake")) {
+            materialBaker.PurgeDisk();
+            materialBaker.Clear();
+        }
+        ImGui::Text("%d textures baked, last bake %.1f ms", materialBaker.BakedCount(), materialBaker.LastBakeMs());
+        ImGui::Text("%d shading / %d bake shader variants", sceneVariants.Count(), bakeVariants.Count());
+        ImGui::Text("Shading variants: %.1f ms to build (%s)", sceneVariants.BuildMs(),
+            sceneVariants.Pipelines() ? "pipelines, shared noise library" : "whole programs");
+        if (ImGui::Checkbox("Noise lookup texture", &noiseLut)) buildMaterialShaders(true);
+        ImGui::BeginDisabled(cpuBake);     // the CPU port has no adaptive octaves
+        if (ImGui::Checkbox("Adaptive octaves", &adaptiveOctaves)) buildMaterialShaders(true);
+        ImGui::EndDisabled();
+        ImGui::Text("%d variants compiling (%s)", sceneVariants.PendingCount(),
+            shaderCompiler.Parallel() ? "parallel" : "serial, built while loading");
+        if (programCache.enabled)
+            ImGui::Text("Program cache: %d loaded, %d compiled, %.0f ms saved", programCache.Hits(),
+                programCache.Misses(), programCache.SavedMs());
+        ImGui::Checkbox("Disk cache", &materialBaker.diskCache);
+        ImGui::Text("%d loaded from disk (%.1f ms), %d written", materialBaker.DiskHits(),
+            materialBaker.DiskLoadMs(), materialBaker.DiskWrites());
+    }
+
+    if (ImGui::CollapsingHeader("Depth pre-pass")) {
+        ImGui::Checkbox("Depth pre-pass", &depthPrepass);
+        ImGui::Text("Scene GPU %.2f ms (%s)", profiler.AverageMs("Scene", true),
+            profiler.enabled ? "profiler" : "enable the profiler to measure");
+    }
+
+    if (ImGui::CollapsingHeader("Dynamic resolution")) {
+        ImGui::Checkbox("Dynamic resolution", &dynamicResolution.enabled);
+        ImGui::SliderFloat("Scene budget (ms)", &dynamicResolution.targetMs, 2.0f, 33.0f, "%.1f");
+        ImGui::SliderFloat("Min scale", &dynamicResolution.minScale, 0.25f, 1.0f, "%.2f");
+        if (dynamicResolution.enabled) {
+            ImGui::Text("Scale %.2f  %dx%d  scene GPU %.2f ms", dynamicResolution.scale,
+                dynamicResolution.Width(), dynamicResolution.Height(), dynamicResolution.SceneGpuMs());
+        }
+    }
+
+    if (ImGui::CollapsingHeader("Frame capture")) {
+        if (ImGui::Button("Screenshot (F12)")) screenshotRequested = true;
+        if (ImGui::Checkbox("Continuous capture", &continuousCapture) && continuousCapture) {
+            std::error_code ec;
+            std::filesystem::create_directories(captureDir, ec);
+            readback.ResetStats();
+        }
+        ImGui::Text("%d captures  %.1f/s  %.1f MB/s", readback.Completed(),
+            readback.CapturesPerSecond(), readback.ThroughputMBps());
+        ImGui::Text("Added latency %.1f frames (%.1f ms)  stalls %d",
+            readback.AverageLatencyFrames(), readback.AverageLatencyMs(), readback.Stalls());
+    }
+
+    if (ImGui::CollapsingHeader("Trace capture")) {
+        ImGui::InputInt("Frames", &traceFrames);
+        if (traceFrames < 1) traceFrames = 1;
+        if (Tracer::Get().IsRecording()) {
+            ImGui::Text("Recording...");
+        }
+        else if (ImGui::Button("Capture")) {
+            startTrace(traceFrames, "trace_" + std::to_string(++traceCaptureCount) + ".json");
+        }
+    }
+
+    ImGui::End();
+}
+
+// ---------------------------------------------------
+// Draw the chessboard with the current materials into the bound framebuffer
+void drawScene(Model& chessboard)
+{
+    // chessboard rotation
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::rotate(model, glm::radians(-90.f), glm::vec3(1, 0, 0));
+    model = glm::translate(model, glm::vec3(0.f, -1.f, 0.f));
+
+    // planes of projection * view * model are in model space, like the mesh bounds
+    Frustum frustum = Frustum::FromMatrix(gProjection * gView * model);
+    const Frustum* cullFrustum = frustumCulling ? &frustum : nullptr;
+
+    // baked materials: every selected material is baked on first use, then it is a texture bind;
+    // procedural materials: one specialized program per pattern, compiled on first use,
+    // reading the material's record of the table
+    const int choices[Model::maxMaterialIDs] = {
+        0, materialWhite, materialBlack, materialBase, materialWhiteSquares, materialBlackSquares };
+    GLuint materialTextures[Model::maxMaterialIDs] = {};
+    GLuint materialShaders[Model::maxMaterialIDs] = {};   // programs, or pipelines
+    int materialIndices[Model::maxMaterialIDs] = {};
+    for (int id = 0; id < Model::maxMaterialIDs; id++) {
+        if (bakedMaterials) {
+            materialTextures[id] = id ? materialBaker.Get(id, choices[id], chessboard.MaterialUvRect(id)) : 0;
+        }
+        else {
+            materialIndices[id] = materialTable.Index(id, choices[id]);
+            materialShaders[id] = sceneVariants.Get(materialTable.Record(materialIndices[id]).pattern);
+        }
+    }
+
+    if (depthPrepass) {
+        profiler.Begin("Depth pre-pass");
+        glUseProgram(depthProgram);
+        glUniformMatrix4fv(glGetUniformLocation(depthProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        chessboard.Draw(depthProgram, cullFrustum);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+        // the procedural shading runs only for the nearest fragment of every pixel
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+        profiler.End();
+    }
+
+    // use shader
+    if (bakedMaterials) {
+        glUseProgram(texturedProgram);
+        glUniformMatrix4fv(glGetUniformLocation(texturedProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+        chessboard.Draw(texturedProgram, cullFrustum, materialTextures);
+    }
+    else {
+        for (GLuint s : materialShaders) {
+            GLuint p = sceneVariants.VertexProgram(s);
+            glUseProgram(p);
+            glUniformMatrix4fv(glGetUniformLocation(p, "model"), 1, GL_FALSE, glm::value_ptr(model));
+        }
+        chessboard.DrawByMaterial([&](int id) {
+            GLuint p = sceneVariants.FragmentProgram(materialShaders[id]);
+            glUseProgram(p);
+            glUniform1i(glGetUniformLocation(p, "uMaterialIndex"), materialIndices[id]);
+            sceneVariants.Use(materialShaders[id]);
+            return materialShaders[id];
+        }, cullFrustum);
+        sceneVariants.Use(0);
+    }
+    meshesCulled = chessboard.culledCount;
+    meshesTotal = (int)chessboard.meshes.size();
+
+    if (depthPrepass) {
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+    }
+}
+
+// Headless run: render into an offscreen target and write it to disk
+// (or run the benchmark path when --benchmark is given)
+int runHeadless(Model& chessboard)
+{
+    RenderTarget target;
+    if (!target.Create(gWindowWidth, gWindowHeight)) return -1;
+
+    int frames = benchmark.enabled ? benchmark.TotalFrames() : 1;
+    if (benchmark.enabled) benchmark.Start();
+
+    for (int i = 0; i < frames; i++) {
+        profiler.BeginFrame();
+        if (benchmark.enabled) applyBenchmarkFrame(i);
+        updateCamera();
+        target.Bind();
+
+        profiler.Begin("Clear");
+        glClearColor(0.5f, 0.6f, 0.6f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        profiler.End();
+
+        profiler.Begin("Scene");
+        drawScene(chessboard);
+        profiler.End();
+
+        // no swap chain: wait for the GPU instead
+        profiler.Begin("Finish");
+        glFinish();
+        profiler.End();
+
+        profiler.EndFrame();
+        Tracer::Get().FrameDone();
+        if (benchmark.enabled) benchmark.FrameDone();
+    }
+
+    if (benchmark.enabled) {
+        return benchmark.Write((const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION),
+            gWindowWidth, gWindowHeight) ? 0 : -1;
+    }
+
+    std::vector<unsigned char> pixels;
+    target.ReadPixels(pixels);
+    if (!writePng(outputPath, target.width, target.height, 3, pixels.data(), true)) return -1;
+    std::cout << "Wrote " << outputPath << " (" << target.width << "x" << target.height << ")" << std::endl;
+    return 0;
+}
+
+// Difference of two RGBA8 images of the same size, alpha ignored
+struct ImageDiff
+{
+    double mean;
+    int max;
+    double psnr;    // dB, INFINITY when identical
+};
+
+// diff, when given, receives the difference (x4) as an RGBA8 image
+ImageDiff compareImages(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b,
+    std::vector<unsigned char>* diff)
+{
+    if (diff) diff->assign(a.size(), 255);
+    double sum = 0.0, squares = 0.0;
+    int maxDiff = 0, samples = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (i % 4 == 3) continue;   // alpha
+        int d = std::abs((int)a[i] - (int)b[i]);
+        if (diff) (*diff)[i] = (unsigned char)std::min(255, d * 4);
+        sum += d;
+        squares += (double)d * d;
+        maxDiff = std::max(maxDiff, d);
+        samples++;
+    }
+    double mse = squares / samples;
+    return { sum / samples, maxDiff, mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : INFINITY };
+}
+
+// A/B of the analytic (sin hash) and lookup-texture noise on every noise material:
+// GPU cost per pixel and image difference, with both images and the difference
+// (x4) written to noiseLutBenchDir
+int runNoiseLutBenchmark(Model& chessboard)
+{
+    std::string fsAnalytic = std::string(fsBakeHeaderSrc) + materialLibSrc + materialColorSrc + fsBakeMainSrc;
+    std::string fsLut = ShaderVariants::Specialize(fsAnalytic, "#define NOISE_LUT\n");
+    ShaderVariants analytic, lut;
+    analytic.Init(vsBakeSrc, fsAnalytic, &shaderCompiler, setupMaterialProgram);
+    lut.Init(vsBakeSrc, fsLut, &shaderCompiler, setupMaterialProgram);
+
+    MaterialProfiler gpuCost;
+    if (!gpuCost.Init()) return -1;
+    std::error_code ec;
+    std::filesystem::create_directories(noiseLutBenchDir, ec);
+
+    printf("Noise LUT benchmark: %dx%d pixels, %d draws per material\n", gpuCost.width, gpuCost.height, gpuCost.iterations);
+    printf("%-14s %6s %-8s %12s %12s %8s %10s %9s %8s\n", "slot", "choice", "pattern", "sin ns/px", "LUT ns/px", "speedup",
+        "mean diff", "max diff", "PSNR dB");
+    bool ok = true;
+    for (int id = 1; id < MaterialTable::slotCount; id++) {
+        for (int choice = 1; choice <= materialTable.Choices(id); choice++) {
+            int index = materialTable.Index(id, choice);
+            const MaterialParams& params = materialTable.Record(index);
+            if (params.pattern == MaterialParams::Flat) continue;
+            glm::vec4 uvRect = chessboard.MaterialUvRect(id);
+            GLuint a = analytic.Wait(params.pattern);
+            GLuint b = lut.Wait(params.pattern);
+            double nsA = gpuCost.Measure(a, uvRect, index);
+            double nsB = gpuCost.Measure(b, uvRect, index);
+
+            std::vector<unsigned char> imageA, imageB, diff;
+            gpuCost.Render(a, uvRect, index, imageA);
+            gpuCost.Render(b, uvRect, index, imageB);
+            ImageDiff d = compareImages(imageA, imageB, &diff);
+            printf("%-14s %6d %-8s %12.3f %12.3f %7.2fx %10.2f %9d %8.1f\n", MaterialTable::SlotName(id), choice,
+                MaterialTable::PatternName(params.pattern), nsA, nsB, nsA / nsB, d.mean, d.max, d.psnr);
+
+            std::string base = noiseLutBenchDir + "/" + std::to_string(id) + "_" + std::to_string(choice);
+            ok &= writePng(base + "_sin.png", gpuCost.width, gpuCost.height, 4, imageA.data(), true);
+            ok &= writePng(base + "_lut.png", gpuCost.width, gpuCost.height, 4, imageB.data(), true);
+            ok &= writePng(base + "_diff.png", gpuCost.width, gpuCost.height, 4, diff.data(), true);
+        }
+    }
+    if (!ok) std::cerr << "Noise LUT benchmark: cannot write images to " << noiseLutBenchDir << std::endl;
+    return ok ? 0 : -1;
+}
+
+// The CPU port (MaterialNoise.hpp) against the GLSL it follows: every noise material
+// of the table is baked by both at the same size over the same UV rectangle, with
+// the analytic noise and every octave, like the port. GPU sin() loses precision on
+// large arguments, so some hash values differ and the images are compared by PSNR;
+// a port that computes something else differs everywhere and fails.
+int runCpuBakeCheck(Model& chessboard)
+{
+    const double minPsnr = 30.0;
+    std::string fs = ShaderVariants::Specialize(std::string(fsBakeHeaderSrc) + materialLibSrc + materialColorSrc +
+        fsBakeMainSrc, "#define FULL_OCTAVES\n");
+    ShaderVariants gpuBake;
+    gpuBake.Init(vsBakeSrc, fs, &shaderCompiler, setupMaterialProgram);
+
+    MaterialProfiler renderer;
+    renderer.width = renderer.height = 512;
+    if (!renderer.Init()) return -1;
+
+    printf("CPU bake check: %dx%d texels, %s\n", renderer.width, renderer.height, simd::IsaName(simd::BestIsa()));
+    printf("%-14s %6s %-8s %10s %9s %8s\n", "slot", "choice", "pattern", "mean diff", "max diff", "PSNR dB");
+    bool ok = true;
+    for (int id = 1; id < MaterialTable::slotCount; id++) {
+        for (int choice = 1; choice <= materialTable.Choices(id); choice++) {
+            int index = materialTable.Index(id, choice);
+            const MaterialParams& params = materialTable.Record(index);
+            if (params.pattern == MaterialParams::Flat) continue;
+            glm::vec4 uvRect = chessboard.MaterialUvRect(id);
+
+            std::vector<unsigned char> gpuPixels, cpuPixels;
+            renderer.Render(gpuBake.Wait(params.pattern), uvRect, index, gpuPixels);
+            generateMaterialTexture(params, renderer.width, uvRect, cpuPixels, workerPool.get(), simd::BestIsa());
+            ImageDiff d = compareImages(gpuPixels, cpuPixels, nullptr);
+            bool match = d.psnr >= minPsnr;
+            printf("%-14s %6d %-8s %10.2f %9d %8.1f%s\n", MaterialTable::SlotName(id), choice,
+                MaterialTable::PatternName(params.pattern), d.mean, d.max, d.psnr, match ? "" : "  MISMATCH");
+            ok &= match;
+        }
+    }
+    if (!ok) std::cerr << "CPU bake check: the CPU port does not match the shader (PSNR < " << minPsnr << " dB)" << std::endl;
+    return ok ? 0 : -1;
+}
+
+// GPU cost of every material choice of the table, drawn full-screen at a fixed
+// resolution with the bake programs (the current --noise-lut / --full-octaves
+// options apply), as nanoseconds per pixel and milliseconds per 1080p frame
+int runMaterialCost(Model& chessboard)
+{
+    MaterialProfiler gpuCost;
+    gpuCost.iterations = 100;
+    if (!gpuCost.Init()) return -1;
+
+    std::ofstream csv;
+    if (!materialCostCsv.empty()) {
+        csv.open(materialCostCsv);
+        if (!csv) {
+            std::cerr << "Material cost: cannot write " << materialCostCsv << std::endl;
+            return -1;
+        }
+        csv << "slot,choice,pattern,octaves,ns_per_pixel,ms_per_1080p" << std::endl;
+    }
+
+    printf("Material cost: %dx%d pixels, %d draws per material, %s noise, %s octaves\n", gpuCost.width, gpuCost.height,
+        gpuCost.iterations, noiseLut ? "LUT" : "sin", adaptiveOctaves ? "adaptive" : "full");
+    printf("%-14s %6s %-8s %7s %10s %12s\n", "slot", "choice", "pattern", "octaves", "ns/px", "ms @1080p");
+    for (int id = 1; id < MaterialTable::slotCount; id++) {
+        for (int choice = 1; choice <= materialTable.Choices(id); choice++) {
+            int index = materialTable.Index(id, choice);
+            const MaterialParams& params = materialTable.Record(index);
+            GLuint program = bakeVariants.Wait(params.pattern);
+            double ns = gpuCost.Measure(program, chessboard.MaterialUvRect(id), index);
+            double frameMs = ns * 1920.0 * 1080.0 / 1e6;
+            const char* slot = MaterialTable::SlotName(id);
+            const char* pattern = MaterialTable::PatternName(params.pattern);
+            printf("%-14s %6d %-8s %7d %10.3f %12.3f\n", slot, choice, pattern, params.octaves, ns, frameMs);
+            if (csv.is_open())
+                csv << slot << "," << choice << "," << pattern << "," << params.octaves << "," << ns << "," << frameMs << std::endl;
+        }
+    }
+    if (csv.is_open()) std::cout << "Wrote " << materialCostCsv << std::endl;
+    return 0;
+}
+
+// Map every baked material already on disk, so switching materials is a texture bind
+void preloadMaterials(Model& chessboard)
+{
+    if (!materialBaker.diskCache) return;
+    auto start = std::chrono::steady_clock::now();
+    int loaded = 0, total = 0;
+    for (int id = 1; id < MaterialTable::slotCount; id++)
+        for (int choice = 1; choice <= materialTable.Choices(id); choice++, total++)
+            loaded += materialBaker.Preload(id, choice, chessboard.MaterialUvRect(id));
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Material cache: " << loaded << " / " << total << " textures loaded in " << ms << " ms" << std::endl;
+}
+
+// Batch run: one context, the same programs and one uploaded model for every job
+int runBatch(Model& chessboard)
+{
+    const int maxChoices[BatchRenderer::SlotCount] = { materialTable.Choices(1), materialTable.Choices(2),
+        materialTable.Choices(3), materialTable.Choices(4), materialTable.Choices(5) };
+    if (!batch.Load(batchFile, maxChoices)) return -1;
+
+    RenderTarget target;
+    if (!target.Create(gWindowWidth, gWindowHeight)) return -1;
+
+    bool ok = batch.Run(target, readback, [&](const BatchRenderer::Job& job) {
+        materialWhite = job.material[BatchRenderer::White];
+        materialBlack = job.material[BatchRenderer::Black];
+        materialBase = job.material[BatchRenderer::Base];
+        materialWhiteSquares = job.material[BatchRenderer::WhiteSquares];
+        materialBlackSquares = job.material[BatchRenderer::BlackSquares];
+        yaw = job.yaw;
+        pitch = job.pitch;
+        radius = job.radius;
+        updateCamera();
+
+        glClearColor(0.5f, 0.6f, 0.6f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        drawScene(chessboard);
+    });
+    return ok ? 0 : -1;
+}
+
+// Turntable run: full orbit at a fixed pitch and radius, written as an image sequence
+int runTurntable(Model& chessboard)
+{
+    RenderTarget target;
+    if (!target.Create(gWindowWidth, gWindowHeight)) return -1;
+
+    pitch = turntable.pitch;
+    radius = turntable.radius;
+    bool ok = turntable.Run(target, readback, [&](float frameYaw) {
+        yaw = frameYaw;
+        updateCamera();
+
+        glClearColor(0.5f, 0.6f, 0.6f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        drawScene(chessboard);
+    });
+    return ok ? 0 : -1;
+}
+
+// Poster run: tiles rendered with sub-frustums of the full-size projection
+int runPoster(Model& chessboard)
+{
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f),
+        (float)poster.width / (float)poster.height, 0.1f, 100.0f);
+
+    bool ok = poster.Run(projection, readback, [&](const glm::mat4& tileProjection) {
+        gProjection = tileProjection;
+        updateCamera();
+
+        glClearColor(0.5f, 0.6f, 0.6f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        drawScene(chessboard);
+    });
+    return ok ? 0 : -1;
+}
+
+// ---------------------------------------------------
+// User interface: overlay, material selector and performance window
+void buildUI()
+{
+    ImGui::PushStyleColor(ImGuiCol_WindowBg, ImVec4(0, 0, 0, 0));               
+    ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0, 0, 0, 0));                 
+    ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.2f, 0.2f, 0.2f, 1)); 
+    ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(0.4f, 0.4f, 0.4f, 1));  
+    ImVec2 viewportSize = ImGui::GetIO().DisplaySize;
+    ImVec2 textPosition = ImVec2(viewportSize.x - 400, viewportSize.y - 50); // Posizionamento
+    ImGui::SetNextWindowPos(textPosition, ImGuiCond_Always, ImVec2(0.0f, 0.0f));
+    ImGui::Begin("Overlay", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoBackground | ImGuiWindowFlags_NoInputs);
+    ImGui::SetWindowSize(ImVec2(400, 50)); // Dimensione pi grande per contenere il testo
+    ImGui::Text("Hold Right Click and move the mouse to rotate");
+    ImGui::Text("Scroll Wheel to Zoom In/Out");
+    ImGui::End();
+    ImGui::Begin("Material Selector", nullptr, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoBackground);
+
+    // Uniform spacing
+    ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(10, 10));
+
+    // Section: White Pieces
+    ImGui::Text("White Pieces");
+    ImGui::SameLine(150);
+    if (ImGui::Button("<##White")) {
+        materialWhite--;
+        if (materialWhite < 1) materialWhite = materialTable.Choices(1);
+    }
+    ImGui::SameLine();
+    ImGui::Text("Material %d", materialWhite);
+    ImGui::SameLine();
+    if (ImGui::Button(">##White")) {
+        materialWhite++;
+        if (materialWhite > materialTable.Choices(1)) materialWhite = 1;
+    }
+
+    // Section: Black Pieces
+    ImGui::Text("Black Pieces");
+    ImGui::SameLine(150);
+    if (ImGui::Button("<##Black")) {
+        materialBlack--;
+        if (materialBlack < 1) materialBlack = materialTable.Choices(2);
+    }
+    ImGui::SameLine();
+    ImGui::Text("Material %d", materialBlack);
+    ImGui::SameLine();
+    if (ImGui::Button(">##Black")) {
+        materialBlack++;
+        if (materialBlack > materialTable.Choices(2)) materialBlack = 1;
+    }
+
+    // Section: Board Base
+    ImGui::Text("Board Base");
+    ImGui::SameLine(150);
+    if (ImGui::Button("<##Base")) {
+        materialBase--;
+        if (materialBase < 1) materialBase = materialTable.Choices(3);
+    }
+    ImGui::SameLine();
+    ImGui::Text("Material %d", materialBase);
+    ImGui::SameLine();
+    if (ImGui::Button(">##Base")) {
+        materialBase++;
+        if (materialBase > materialTable.Choices(3)) materialBase = 1;
+    }
+
+    // Section: White Squares
+    ImGui::Text("White Squares");
+    ImGui::SameLine(150);
+    if (ImGui::Button("<##WS")) {
+        materialWhiteSquares--;
+        if (materialWhiteSquares < 1) materialWhiteSquares = materialTable.Choices(4);
+    }
+    ImGui::SameLine();
+    ImGui::Text("Material %d", materialWhiteSquares);
+    ImGui::SameLine();
+    if (ImGui::Button(">##WS")) {
+        materialWhiteSquares++;
+        if (materialWhiteSquares > materialTable.Choices(4)) materialWhiteSquares = 1;
+    }
+
+    // Section: Black Squares
+    ImGui::Text("Black Squares");
+    ImGui::SameLine(150);
+    if (ImGui::Button("<##BS")) {
+        materialBlackSquares--;
+        if (materialBlackSquares < 1) materialBlackSquares = materialTable.Choices(5);
+    }
+    ImGui::SameLine();
+    ImGui::Text("Material %d", materialBlackSquares);
+    ImGui::SameLine();
+    if (ImGui::Button(">##BS")) {
+        materialBlackSquares++;
+        if (materialBlackSquares > materialTable.Choices(5)) materialBlackSquares = 1;
+    }
+
+    ImGui::PopStyleVar(); // Restore spacing
+    ImGui::End();
+
+    ImGui::PopStyleColor(4); // Restore colors
+
+    drawPerformanceWindow();
+    if (showProfiler) profiler.DrawWindow(&showProfiler);
+}
+
+// Numeric option values: the whole string must be a number, not below minValue
+bool parseInt(const char* s, int& out, int minValue = INT_MIN)
+{
+    char* end = nullptr;
+    errno = 0;
+    long v = strtol(s, &end, 10);
+    if (end == s || *end != '\0' || errno == ERANGE || v < minValue || v > INT_MAX) return false;
+    out = (int)v;
+    return true;
+}
+
+bool parseFloat(const char* s, float& out, float minValue = -INFINITY)
+{
+    char* end = nullptr;
+    errno = 0;
+    float v = strtof(s, &end);
+    if (end == s || *end != '\0' || errno == ERANGE || !std::isfinite(v) || v < minValue) return false;
+    out = v;
+    return true;
+}
+
+// Lists like 800x600 or 1,2,3: exactly count fields, each a whole number
+std::vector<std::string> splitOption(const char* s, char separator)
+{
+    std::vector<std::string> fields(1);
+    for (; *s; s++) {
+        if (*s == separator) fields.emplace_back();
+        else fields.back() += *s;
+    }
+    return fields;
+}
+
+bool parseInts(const char* s, char separator, int* out, int count, int minValue = INT_MIN)
+{
+    std::vector<std::string> fields = splitOption(s, separator);
+    if ((int)fields.size() != count) return false;
+    for (int k = 0; k < count; k++)
+        if (!parseInt(fields[k].c_str(), out[k], minValue)) return false;
+    return true;
+}
+
+bool parseFloats(const char* s, char separator, float* out, int count)
+{
+    std::vector<std::string> fields = splitOption(s, separator);
+    if ((int)fields.size() != count) return false;
+    for (int k = 0; k < count; k++)
+        if (!parseFloat(fields[k].c_str(), out[k])) return false;
+    return true;
+}
+
+// value == nullptr: the option is the last argument
+int optionError(const std::string& option, const char* value)
+{
+    if (value) std::cerr << "Invalid value for " << option << ": " << value << std::endl;
+    else std::cerr << "Missing value for " << option << std::endl;
+    return -1;
+}
+
 // ---------------------------------------------------
 // MAIN
-int main()
+int main(int argc, char** argv)
 {
+    // however main returns, a capture that is still running (--trace 0, or runs
+    // that end before N frames) is written once the workers have stopped recording
+    struct TraceFlush
+    {
+        ~TraceFlush()
+        {
+            workerPool.reset();
+            Tracer::Get().Finish();
+        }
+    } traceFlush;
+
+    // command line options
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        // the next argument as the value of arg; false (value == nullptr) when there is none
+        const char* value = nullptr;
+        auto takeValue = [&] { value = i + 1 < argc ? argv[++i] : nullptr; return value != nullptr; };
+        if (arg == "--on-demand") {
+            renderOnDemand = true;
+        }
+        else if (arg == "--vsync") {
+            framePacer.vsync = true;
+        }
+        else if (arg == "--no-vsync") {
+            framePacer.vsync = false;
+        }
+        else if (arg == "--fps-cap") {
+            if (!takeValue() || !parseFloat(value, framePacer.fpsCap, 0.0f)) return optionError(arg, value);
+        }
+        else if (arg == "--background-fps") {
+            if (!takeValue() || !parseFloat(value, framePacer.backgroundFps) || framePacer.backgroundFps <= 0.0f)
+                return optionError(arg, value);
+        }
+        else if (arg == "--no-throttle") {
+            framePacer.throttleInBackground = false;
+        }
+        else if (arg == "--low-latency") {
+            lowLatency = true;
+        }
+        else if (arg == "--profiler") {
+            showProfiler = true;
+        }
+        else if (arg == "--dynamic-res") {
+            float fps = 0.0f;
+            if (!takeValue() || !parseFloat(value, fps) || fps <= 0.0f) return optionError(arg, value);
+            dynamicResolution.enabled = true;
+            dynamicResolution.SetTargetFps(fps);
+        }
+        else if (arg == "--procedural") {
+            bakedMaterials = false;
+        }
+        else if (arg == "--bake-size") {
+            if (!takeValue() || !parseInt(value, materialBaker.size, 1)) return optionError(arg, value);
+        }
+        else if (arg == "--cpu-bake") {
+            cpuBake = true;
+        }
+        else if (arg == "--no-bake-cache") {
+            materialBaker.diskCache = false;
+        }
+        else if (arg == "--no-program-cache") {
+            programCache.enabled = false;
+        }
+        else if (arg == "--no-separable-shaders") {
+            separableShaders = false;
+        }
+        else if (arg == "--noise-lut") {
+            noiseLut = true;
+        }
+        else if (arg == "--full-octaves") {
+            adaptiveOctaves = false;
+        }
+        else if (arg == "--noise-lut-bench") {
+            noiseLutBenchDir = i + 1 < argc && argv[i + 1][0] != '-' ? argv[++i] : "noise_lut_bench";
+        }
+        else if (arg == "--cpu-bake-check") {
+            cpuBakeCheck = true;
+        }
+        else if (arg == "--material-cost") {
+            materialCost = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-') materialCostCsv = argv[++i];
+        }
+        else if (arg == "--noise-bench") {
+            noiseBenchSize = 256;
+            if (i + 1 < argc && argv[i + 1][0] != '-' && !parseInt(argv[++i], noiseBenchSize, 1)) return optionError(arg, argv[i]);
+        }
+        else if (arg == "--depth-prepass") {
+            depthPrepass = true;
+        }
+        else if (arg == "--no-culling") {
+            frustumCulling = false;
+        }
+        else if (arg == "--size") {
+            int size[2];
+            if (!takeValue() || !parseInts(value, 'x', size, 2, 1)) return optionError(arg, value);
+            gWindowWidth = size[0];
+            gWindowHeight = size[1];
+        }
+        else if (arg == "--headless") {
+            headless = true;
+        }
+        else if (arg == "--headless-api") {
+            if (!takeValue()) return optionError(arg, value);
+            headlessApi = value;
+        }
+        else if (arg == "--output") {
+            if (!takeValue()) return optionError(arg, value);
+            outputPath = value;
+        }
+        else if (arg == "--camera") {
+            float camera[3];
+            if (!takeValue() || !parseFloats(value, ',', camera, 3)) return optionError(arg, value);
+            yaw = camera[0];
+            pitch = camera[1];
+            radius = camera[2];
+        }
+        else if (arg == "--batch") {
+            if (!takeValue()) return optionError(arg, value);
+            batchFile = value;
+        }
+        else if (arg == "--batch-out") {
+            if (!takeValue()) return optionError(arg, value);
+            batch.outputDir = value;
+        }
+        else if (arg == "--atlas") {
+            if (!takeValue() || !parseInt(value, batch.atlasColumns, 1)) return optionError(arg, value);
+        }
+        else if (arg == "--materials") {
+            // checked against the material table once it is loaded
+            int choices[5];
+            if (!takeValue() || !parseInts(value, ',', choices, 5, 1)) return optionError(arg, value);
+            materialWhite = choices[0];
+            materialBlack = choices[1];
+            materialBase = choices[2];
+            materialWhiteSquares = choices[3];
+            materialBlackSquares = choices[4];
+        }
+        else if (arg == "--material-table") {
+            if (!takeValue()) return optionError(arg, value);
+            materialTableFile = value;
+        }
+        else if (arg == "--turntable") {
+            if (!takeValue()) return optionError(arg, value);
+            turntable.enabled = true;
+            turntable.outputDir = value;
+        }
+        else if (arg == "--turntable-frames") {
+            if (!takeValue() || !parseInt(value, turntable.frames, 1)) return optionError(arg, value);
+        }
+        else if (arg == "--turntable-camera") {
+            float camera[2];
+            if (!takeValue() || !parseFloats(value, ',', camera, 2)) return optionError(arg, value);
+            turntable.pitch = camera[0];
+            turntable.radius = camera[1];
+        }
+        else if (arg == "--poster") {
+            int size[2];
+            if (!takeValue() || !parseInts(value, 'x', size, 2, 1)) return optionError(arg, value);
+            if (!takeValue()) return optionError(arg, value);
+            poster.width = size[0];
+            poster.height = size[1];
+            poster.enabled = true;
+            poster.outputPath = value;
+        }
+        else if (arg == "--poster-tile") {
+            if (!takeValue() || !parseInt(value, poster.tileSize, 1)) return optionError(arg, value);
+        }
+        else if (arg == "--benchmark") {
+            benchmark.enabled = true;
+        }
+        else if (arg == "--benchmark-frames") {
+            if (!takeValue() || !parseInt(value, benchmark.frames, 1)) return optionError(arg, value);
+        }
+        else if (arg == "--benchmark-out") {
+            if (!takeValue()) return optionError(arg, value);
+            benchmark.outputPath = value;
+        }
+        else if (arg == "--trace") {
+            if (!takeValue() || !parseInt(value, traceFrames, 0)) return optionError(arg, value);
+            if (!takeValue()) return optionError(arg, value);
+            tracePath = value;
+            // record from the very start, so that startup hitches show up too
+            Tracer::Get().Start(traceFrames, tracePath);
+        }
+        else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return -1;
+        }
+    }
+
+    // the CPU port evaluates every octave: the GPU bakes and the shading use all of
+    // them too, so a material looks the same whichever path drew it
+    if (cpuBake) adaptiveOctaves = false;
+
+    Tracer::Get().SetThreadName("Main");
+
+    if (!materialTable.Load(materialTableFile)) return -1;
+    const int startChoices[] = { 0, materialWhite, materialBlack, materialBase, materialWhiteSquares, materialBlackSquares };
+    for (int id = 1; id < MaterialTable::slotCount; id++) {
+        if (startChoices[id] > materialTable.Choices(id)) {
+            std::cerr << "--materials: " << MaterialTable::SlotName(id) << " has " << materialTable.Choices(id)
+                << " choices in " << materialTableFile << std::endl;
+            return -1;
+        }
+    }
+    workerPool = std::make_unique<ThreadPool>();
+
+    // CPU only, no window or context needed
+    if (noiseBenchSize > 0) {
+        runNoiseBenchmark(*workerPool, materialTable, noiseBenchSize);
+        return 0;
+    }
+
     // 1) Initialize
     if (!initWindowAndGL()) return -1;
-    // ImGui setup
-    IMGUI_CHECKVERSION();
-    ImGui::CreateContext();
-    ImGuiIO& io = ImGui::GetIO(); (void)io;
-    ImGui_ImplGlfw_InitForOpenGL(gWindow, true);
-    ImGui_ImplOpenGL3_Init("#version 330 core");
-    ImGui::StyleColorsDark();
+    bool offscreenOnly = headless || !batchFile.empty() || turntable.enabled || poster.enabled || !noiseLutBenchDir.empty() ||
+        materialCost || cpuBakeCheck;
+    if (!offscreenOnly) {
+        // ImGui setup
+        IMGUI_CHECKVERSION();
+        ImGui::CreateContext();
+        ImGuiIO& io = ImGui::GetIO(); (void)io;
+        ImGui_ImplGlfw_InitForOpenGL(gWindow, true);
+        ImGui_ImplOpenGL3_Init("#version 330 core");
+        ImGui::StyleColorsDark();
+
+        framePacer.Init(gWindow);
+    }
+    profiler.Init();
+    readback.Init(workerPool.get());
+    dynamicResolution.Init();
+
+    // feed the profiler scopes into the trace while a capture is running
+    calibrateTraceGpuClock();
+    profiler.onCpuScope = [](const char* name, Profiler::Clock::time_point start, Profiler::Clock::time_point end) {
+        Tracer& tracer = Tracer::Get();
+        if (tracer.IsRecording())
+            tracer.Record(name, "frame", tracer.ToUs(start), std::chrono::duration<double, std::micro>(end - start).count());
+    };
+    profiler.onGpuScope = [](const char* name, GLuint64 startNs, GLuint64 endNs) {
+        Tracer::Get().RecordGpu(name, startNs, endNs);
+        if (benchmark.enabled) benchmark.AddGpuTime(name, (float)((endNs - startNs) / 1e6));
+    };
+
+    // the benchmark measures raw throughput: no pacing, no idling
+    if (benchmark.enabled) {
+        framePacer.SetVSync(false);
+        framePacer.fpsCap = 0.0f;
+        framePacer.throttleInBackground = false;
+        renderOnDemand = false;
+        lowLatency = false;
+    }
 
    
-    GLuint program = createProgram(vsSrc, fsSrc2);
+    std::string fsTextured = std::string(fsHeaderSrc) + lightingSrc + fsTexturedMainSrc;
+    createCameraBuffer();
+    materialTable.Init(materialsBinding);
+    noiseLutTexture.Init();
+    noiseLutTexture.Bind(noiseLutUnit);
+    // interactive runs never wait for a variant in a frame: each one is drawn with its
+    // flat fallback until the driver has built it (or, without parallel compilation,
+    // all of them are built here, before the first frame)
+    buildMaterialShaders(!offscreenOnly);
+    texturedProgram = createProgram(vsSrc, fsTextured.c_str());
+    bindCameraBlock(texturedProgram);
+    if (cpuBake) {
+        materialBaker.cpuBake = [](int materialID, int choice, const glm::vec4& uvRect, int size,
+            std::vector<unsigned char>& rgba) {
+            int index = materialTable.Index(materialID, choice);
+            if (index == 0) return false;
+            generateMaterialTexture(materialTable.Record(index), size, uvRect, rgba, workerPool.get(), simd::BestIsa());
+            return true;
+        };
+        materialBaker.cpuBakeVersion = materialNoiseVersion;
+    }
+    depthProgram = createProgram(vsDepthSrc, fsDepthSrc);
+    bindCameraBlock(depthProgram);
      
     
     Model myChessboard("chessboard1.fbx");
+    if (bakedMaterials) preloadMaterials(myChessboard);
    
 
     //Setup projection
-    gProjection = glm::perspective(glm::radians(45.0f),
-        (float)gWindowWidth / (float)gWindowHeight,
-        0.1f, 100.0f);
+    updateProjection();
+
+    if (offscreenOnly) {
+        int result = cpuBakeCheck ? runCpuBakeCheck(myChessboard)
+            : materialCost ? runMaterialCost(myChessboard)
+            : !noiseLutBenchDir.empty() ? runNoiseLutBenchmark(myChessboard)
+            : !batchFile.empty() ? runBatch(myChessboard)
+            : turntable.enabled ? runTurntable(myChessboard)
+            : poster.enabled ? runPoster(myChessboard)
+            : runHeadless(myChessboard);
+        reportProgramCache();
+        readback.Destroy();
+        dynamicResolution.Destroy();
+        materialBaker.Destroy();
+        sceneVariants.Destroy();
+        bakeVariants.Destroy();
+        noiseLutTexture.Destroy();
+        materialTable.Destroy();
+        glfwTerminate();
+        return result;
+    }
+
+    if (benchmark.enabled) benchmark.Start();
+
+    bool programsReported = false;
 
     // 5) Main loop
     while (!glfwWindowShouldClose(gWindow)) {
+        // swap in the shader variants the driver has finished
+        int variantsPending = sceneVariants.PendingCount();
+        sceneVariants.Poll();
+        if (sceneVariants.PendingCount() < variantsPending) requestRedraw(1);
+
+        // Render on demand: sleep until an event marks the frame dirty
+        if (renderOnDemand) {
+            if (redrawFrames <= 0) {
+                glfwWaitEventsTimeout(idleWaitTimeout);
+                framePacer.Resync();
+            }
+            else
+                glfwPollEvents();
+            if (redrawFrames <= 0) continue;
+            redrawFrames--;
+        }
+        // nothing to show while minimized
+        if (framePacer.IsIconified()) {
+            glfwWaitEvents();
+            framePacer.Resync();
+            continue;
+        }
+
         // compute deltaTime
         float currentTime = (float)glfwGetTime();
         deltaTime = currentTime - lastFrame;
@@ -565,169 +1816,103 @@ int main()
 
 
         processInput(gWindow);
-      
+        profiler.BeginFrame();
+
+        // build the UI first, so the camera can be latched as late as possible
+        profiler.Begin("ImGui build");
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
+        buildUI();
+        ImGui::Render();
+        profiler.End();
 
-     
+        // Low latency: pick up the newest orbit input right before drawing
+        if (lowLatency) glfwPollEvents();
+        double frameInputTime = pendingInputTime;
+        pendingInputTime = -1.0;
+        if (benchmark.enabled) applyBenchmarkFrame(benchmark.Frame());
+        updateCamera();
+
+        // Dynamic resolution: the scene goes to a scaled target, upscaled before the UI
+        if (dynamicResolution.enabled) dynamicResolution.BeginScene(gWindowWidth, gWindowHeight);
 
         // clear
+        profiler.Begin("Clear");
         glClearColor(0.5f, 0.6f, 0.6f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        profiler.End();
 
-        // Recompute cameraPos from yaw, pitch, radius, plus cameraOffset
-        float radYaw = glm::radians(yaw);
-        float radPitch = glm::radians(pitch);
-
-        float x = radius * cos(radPitch) * sin(radYaw);
-        float y = radius * sin(radPitch);
-        float z = radius * cos(radPitch) * cos(radYaw);
-
-        glm::vec3 position = orbitCenter + glm::vec3(x, y, z) + cameraOffset;
-        glm::vec3 front = glm::normalize(orbitCenter + cameraOffset - position);
-        glm::vec3 cameraDir = glm::normalize(position - orbitCenter);
+        profiler.Begin("Scene");
+        drawScene(myChessboard);
+        profiler.End();
 
-        // build the view matrix
-        gView = glm::lookAt(position, position + front, glm::vec3(0.f, 1.f, 0.f));
-
-        // use shader
-        glUseProgram(program);
-
-        // set uniform view / proj
-        GLint viewLoc = glGetUniformLocation(program, "view");
-        GLint projLoc = glGetUniformLocation(program, "projection");
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(gView));
-        glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(gProjection));
-        GLint cameraDirLoc = glGetUniformLocation(program, "cameraDir");
-        glUniform3f(cameraDirLoc, cameraDir.x, cameraDir.y, cameraDir.z);
-
-        // chessboard rotation
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::rotate(model, glm::radians(-90.f), glm::vec3(1, 0, 0));
-        model = glm::translate(model, glm::vec3(0.f, -1.f, 0.f));
-
-        GLint modelLoc = glGetUniformLocation(program, "model");
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-        myChessboard.Draw(program);
-
-        // 2. User interface
-        ImGui::PushStyleColor(ImGuiCol_WindowBg, ImVec4(0, 0, 0, 0));               
-        ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0, 0, 0, 0));                 
-        ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.2f, 0.2f, 0.2f, 1)); 
-        ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(0.4f, 0.4f, 0.4f, 1));  
-        ImVec2 viewportSize = ImGui::GetIO().DisplaySize;
-        ImVec2 textPosition = ImVec2(viewportSize.x - 400, viewportSize.y - 50); // Posizionamento
-        ImGui::SetNextWindowPos(textPosition, ImGuiCond_Always, ImVec2(0.0f, 0.0f));
-        ImGui::Begin("Overlay", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoBackground | ImGuiWindowFlags_NoInputs);
-        ImGui::SetWindowSize(ImVec2(400, 50)); // Dimensione pi grande per contenere il testo
-        ImGui::Text("Hold Right Click and move the mouse to rotate");
-        ImGui::Text("Scroll Wheel to Zoom In/Out");
-        ImGui::End();
-        ImGui::Begin("Material Selector", nullptr, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoBackground);
-
-        // Uniform spacing
-        ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(10, 10));
-
-        // Section: White Pieces
-        ImGui::Text("White Pieces");
-        ImGui::SameLine(150);
-        if (ImGui::Button("<##White")) {
-            materialWhite--;
-            if (materialWhite < 1) materialWhite = maxMaterialsPieces;
-        }
-        ImGui::SameLine();
-        ImGui::Text("Material %d", materialWhite);
-        ImGui::SameLine();
-        if (ImGui::Button(">##White")) {
-            materialWhite++;
-            if (materialWhite > maxMaterialsPieces) materialWhite = 1;
-        }
-
-        // Section: Black Pieces
-        ImGui::Text("Black Pieces");
-        ImGui::SameLine(150);
-        if (ImGui::Button("<##Black")) {
-            materialBlack--;
-            if (materialBlack < 1) materialBlack = maxMaterialsPieces;
-        }
-        ImGui::SameLine();
-        ImGui::Text("Material %d", materialBlack);
-        ImGui::SameLine();
-        if (ImGui::Button(">##Black")) {
-            materialBlack++;
-            if (materialBlack > maxMaterialsPieces) materialBlack = 1;
-        }
-
-        // Section: Board Base
-        ImGui::Text("Board Base");
-        ImGui::SameLine(150);
-        if (ImGui::Button("<##Base")) {
-            materialBase--;
-            if (materialBase < 1) materialBase = maxMaterialsPieces;
-        }
-        ImGui::SameLine();
-        ImGui::Text("Material %d", materialBase);
-        ImGui::SameLine();
-        if (ImGui::Button(">##Base")) {
-            materialBase++;
-            if (materialBase > maxMaterialsPieces) materialBase = 1;
-        }
-
-        // Section: White Squares
-        ImGui::Text("White Squares");
-        ImGui::SameLine(150);
-        if (ImGui::Button("<##WS")) {
-            materialWhiteSquares--;
-            if (materialWhiteSquares < 1) materialWhiteSquares = maxMaterials;
-        }
-        ImGui::SameLine();
-        ImGui::Text("Material %d", materialWhiteSquares);
-        ImGui::SameLine();
-        if (ImGui::Button(">##WS")) {
-            materialWhiteSquares++;
-            if (materialWhiteSquares > maxMaterials) materialWhiteSquares = 1;
-        }
-
-        // Section: Black Squares
-        ImGui::Text("Black Squares");
-        ImGui::SameLine(150);
-        if (ImGui::Button("<##BS")) {
-            materialBlackSquares--;
-            if (materialBlackSquares < 1) materialBlackSquares = maxMaterialsPieces;
-        }
-        ImGui::SameLine();
-        ImGui::Text("Material %d", materialBlackSquares);
-        ImGui::SameLine();
-        if (ImGui::Button(">##BS")) {
-            materialBlackSquares++;
-            if (materialBlackSquares > maxMaterialsPieces) materialBlackSquares = 1;
-        }
-
-        ImGui::PopStyleVar(); // Restore spacing
-        ImGui::End();
-
-        ImGui::PopStyleColor(4); // Restore colors
-        
+        if (dynamicResolution.enabled) {
+            profiler.Begin("Upscale");
+            dynamicResolution.EndScene(gWindowWidth, gWindowHeight);
+            profiler.End();
+        }
 
-        ImGui::Render();
+        profiler.Begin("ImGui render");
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        profiler.End();
+
+        // keep drawing while a widget is being interacted with
+        if (ImGui::IsAnyItemActive()) requestRedraw();
+
+        // queue readbacks of the finished frame; they complete a few frames later on the workers
+        if (screenshotRequested || continuousCapture) {
+            std::string path = screenshotRequested
+                ? "screenshot_" + std::to_string(++screenshotCount) + ".png"
+                : captureDir + "/frame_" + std::to_string(captureFrame++) + ".png";
+            readback.Capture(0, gWindowWidth, gWindowHeight, [path](std::vector<unsigned char>& pixels, int w, int h) {
+                writePng(path, w, h, 3, pixels.data(), true);
+            });
+            screenshotRequested = false;
+        }
+        readback.Poll();
 
-        GLint blackMaterialLoc = glGetUniformLocation(program, "uMaterialBlack");
-        GLint whiteMaterialLoc = glGetUniformLocation(program, "uMaterialWhite");
-        GLint blackSqMaterialLoc = glGetUniformLocation(program, "uMaterialBlackSquares");
-        GLint whiteSqMaterialLoc = glGetUniformLocation(program, "uMaterialWhiteSquares");
-        GLint boardMaterialLoc = glGetUniformLocation(program, "uMaterialBoard");
-        glUniform1i(blackMaterialLoc, materialBlack);
-        glUniform1i(whiteMaterialLoc, materialWhite);
-        glUniform1i(blackSqMaterialLoc, materialBlackSquares);
-        glUniform1i(whiteSqMaterialLoc, materialWhiteSquares);
-        glUniform1i(boardMaterialLoc, materialBase);
         // swap
+        profiler.Begin("Swap");
         glfwSwapBuffers(gWindow);
-        glfwPollEvents();
+        // don't let the driver queue frames ahead of the input
+        if (lowLatency) glFinish();
+        profiler.End();
+        profiler.EndFrame();
+        Tracer::Get().FrameDone();
+
+        // the first frame has built every program it needs
+        if (!programsReported) {
+            reportProgramCache();
+            programsReported = true;
+        }
+
+        if (frameInputTime >= 0.0) {
+            latencyLastMs = (glfwGetTime() - frameInputTime) * 1000.0;
+            latencyAvgMs = latencyAvgMs > 0.0 ? latencyAvgMs * 0.9 + latencyLastMs * 0.1 : latencyLastMs;
+            if (latencyLastMs > latencyMaxMs) latencyMaxMs = latencyLastMs;
+        }
+
+        if (benchmark.enabled) {
+            benchmark.FrameDone();
+            if (benchmark.Finished()) {
+                benchmark.Write((const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION),
+                    gWindowWidth, gWindowHeight);
+                glfwSetWindowShouldClose(gWindow, true);
+            }
+        }
+
+        framePacer.EndFrame();
+        if (!renderOnDemand && !lowLatency) glfwPollEvents();
     }
+    readback.Flush();
+    readback.Destroy();
+    dynamicResolution.Destroy();
+    materialBaker.Destroy();
+    sceneVariants.Destroy();
+    bakeVariants.Destroy();
+    noiseLutTexture.Destroy();
+    materialTable.Destroy();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();